@@ -8,6 +8,14 @@
 
 namespace {
 volatile bool wdtEnable = false;
+// reset flags given by optiboot in r2 (MCUSR is cleared by the bootloader)
+uint8_t bootResetFlags __attribute__((section(".noinit")));
+} // namespace
+
+void saveBootResetFlags() __attribute__((naked, used, section(".init0")));
+void saveBootResetFlags() {
+  // r1 is not yet zero, only a store of r2 is possible here
+  __asm__ __volatile__("sts %0, r2\n" : "=m"(bootResetFlags) :);
 }
 
 void powerDown(Sleep period) {
@@ -41,6 +49,25 @@ void configure_wdt() {
 
 void rst_wdt() { wdt_reset(); }
 
+ResetCause reset_cause() {
+  static uint8_t flags = 0;
+  if (flags == 0) {
+    // without optiboot the flags are still in MCUSR
+    flags = MCUSR != 0 ? MCUSR : bootResetFlags;
+    MCUSR = 0;
+  }
+  if (flags & (1 << WDRF)) {
+    return ResetCause::Watchdog;
+  }
+  if (flags & (1 << BORF)) {
+    return ResetCause::BrownOut;
+  }
+  if (flags & (1 << EXTRF)) {
+    return ResetCause::External;
+  }
+  return ResetCause::PowerOn;
+}
+
 ISR(WDT_vect) {
   if (!wdtEnable) {
     // WDIE & WDIF is cleared in hardware upon entering this ISR
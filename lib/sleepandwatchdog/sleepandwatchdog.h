@@ -15,8 +15,17 @@ enum class Sleep : unsigned char {
   FOREVER
 };
 
+enum class ResetCause : unsigned char {
+  PowerOn,
+  External,
+  BrownOut,
+  Watchdog,
+};
+
 void powerDown(Sleep period);
 void configure_wdt();
 void rst_wdt();
+// Cause of the last reset, from MCUSR or from the copy given by optiboot in r2.
+ResetCause reset_cause();
 
 #endif
\ No newline at end of file
@@ -1,100 +1,164 @@
 #include "3outof6.h"
-#include <array>
+#include <lmic/lmic_table.h>
+
+#include "profiling.h"
+
+// Number of encoded bits used as index in the decoding table:
+//  - 6 : one "3 out of 6" symbol at a time, 64 bytes table
+//  - 12 : the two symbols of a decoded byte at once, 8 KiB table (host targets)
+#ifndef DECODE_3OUTOF6_TABLE_BITS
+#define DECODE_3OUTOF6_TABLE_BITS 6
+#endif
+
+static_assert(DECODE_3OUTOF6_TABLE_BITS == 6 || DECODE_3OUTOF6_TABLE_BITS == 12,
+              "DECODE_3OUTOF6_TABLE_BITS must be 6 or 12");
+
+namespace {
+
+// "3 out of 6" code of each nibble (EN 13757-4 T mode)
+constexpr uint8_t encodeTab[16] = {0x16, 0x0D, 0x0E, 0x0B, 0x1C, 0x19, 0x1A, 0x13,
+                                   0x2C, 0x25, 0x26, 0x23, 0x34, 0x31, 0x32, 0x29};
+
+constexpr uint8_t bitCount(uint8_t value) {
+  uint8_t count = 0;
+  for (; value != 0; value >>= 1) {
+    count += value & 1;
+  }
+  return count;
+}
+
+constexpr bool validEncodeTab() {
+  for (uint8_t nibble = 0; nibble < 16; nibble++) {
+    if (encodeTab[nibble] > 0x3F || bitCount(encodeTab[nibble]) != 3) {
+      return false;
+    }
+    for (uint8_t other = 0; other < nibble; other++) {
+      if (encodeTab[other] == encodeTab[nibble]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(validEncodeTab(), "each nibble must be coded by a distinct 6-bit symbol with 3 bits set");
+
+// Decoded nibble of a 6-bit symbol, 0xFF if it is not a valid "3 out of 6" coding
+constexpr uint8_t decodeSymbol(uint8_t symbol) {
+  for (uint8_t nibble = 0; nibble < 16; nibble++) {
+    if (encodeTab[nibble] == symbol) {
+      return nibble;
+    }
+  }
+  return 0xFF;
+}
+
+template <typename T, uint16_t N> struct Table {
+  T values[N];
+};
+
+#if DECODE_3OUTOF6_TABLE_BITS == 6
+
+using DecodeTable = Table<uint8_t, 64>;
+
+constexpr DecodeTable makeDecodeTab() {
+  DecodeTable tab = {};
+  for (uint8_t symbol = 0; symbol < 64; symbol++) {
+    tab.values[symbol] = decodeSymbol(symbol);
+  }
+  return tab;
+}
+
+constexpr uint8_t countValid(const DecodeTable &tab) {
+  uint8_t count = 0;
+  for (uint8_t symbol = 0; symbol < 64; symbol++) {
+    count += tab.values[symbol] != 0xFF;
+  }
+  return count;
+}
+
+static_assert(countValid(makeDecodeTab()) == 16, "exactly 16 valid symbols");
+static_assert(makeDecodeTab().values[0x16] == 0x00 && makeDecodeTab().values[0x29] == 0x0F,
+              "decoding table does not match EN 13757-4");
 
-// clang-format off
 // Table for decoding a 6-bit "3 out of 6" encoded data into 4-bit
 // data. The value 0xFF indicates invalid "3 out of 6" coding
-static std::array<uint8_t,64> decodeTab = {0xFF,  //  "3 out of 6" encoded 0x00 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x01 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x02 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x03 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x04 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x05 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x06 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x07 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x08 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x09 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x0A decoded
-                                0x03,  //  "3 out of 6" encoded 0x0B decoded
-                                0xFF,  //  "3 out of 6" encoded 0x0C decoded
-                                0x01,  //  "3 out of 6" encoded 0x0D decoded
-                                0x02,  //  "3 out of 6" encoded 0x0E decoded
-                                0xFF,  //  "3 out of 6" encoded 0x0F decoded
-                                0xFF,  //  "3 out of 6" encoded 0x10 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x11 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x12 decoded
-                                0x07,  //  "3 out of 6" encoded 0x13 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x14 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x15 decoded
-                                0x00,  //  "3 out of 6" encoded 0x16 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x17 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x18 decoded
-                                0x05,  //  "3 out of 6" encoded 0x19 decoded
-                                0x06,  //  "3 out of 6" encoded 0x1A decoded
-                                0xFF,  //  "3 out of 6" encoded 0x1B decoded
-                                0x04,  //  "3 out of 6" encoded 0x1C decoded
-                                0xFF,  //  "3 out of 6" encoded 0x1D decoded
-                                0xFF,  //  "3 out of 6" encoded 0x1E decoded
-                                0xFF,  //  "3 out of 6" encoded 0x1F decoded
-                                0xFF,  //  "3 out of 6" encoded 0x20 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x21 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x22 decoded
-                                0x0B,  //  "3 out of 6" encoded 0x23 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x24 decoded
-                                0x09,  //  "3 out of 6" encoded 0x25 decoded
-                                0x0A,  //  "3 out of 6" encoded 0x26 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x27 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x28 decoded
-                                0x0F,  //  "3 out of 6" encoded 0x29 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x2A decoded
-                                0xFF,  //  "3 out of 6" encoded 0x2B decoded
-                                0x08,  //  "3 out of 6" encoded 0x2C decoded
-                                0xFF,  //  "3 out of 6" encoded 0x2D decoded
-                                0xFF,  //  "3 out of 6" encoded 0x2E decoded
-                                0xFF,  //  "3 out of 6" encoded 0x2F decoded
-                                0xFF,  //  "3 out of 6" encoded 0x30 decoded
-                                0x0D,  //  "3 out of 6" encoded 0x31 decoded
-                                0x0E,  //  "3 out of 6" encoded 0x32 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x33 decoded
-                                0x0C,  //  "3 out of 6" encoded 0x34 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x35 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x36 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x37 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x38 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x39 decoded
-                                0xFF,  //  "3 out of 6" encoded 0x3A decoded
-                                0xFF,  //  "3 out of 6" encoded 0x3B decoded
-                                0xFF,  //  "3 out of 6" encoded 0x3C decoded
-                                0xFF,  //  "3 out of 6" encoded 0x3D decoded
-                                0xFF,  //  "3 out of 6" encoded 0x3E decoded
-                                0xFF}; // "3 out of 6" encoded 0x3F decoded
-// clang-format on
+CONST_TABLE(DecodeTable, decodeTab) = makeDecodeTab();
+
+// Decode 2 symbols into a byte, first symbol is the high nibble.
+// Return false if one of the symbol is invalid
+inline bool decodeByte(uint8_t symbolHigh, uint8_t symbolLow, uint8_t &decoded) {
+  const uint8_t high = table_get_u1(RESOLVE_TABLE(decodeTab).values, symbolHigh);
+  const uint8_t low = table_get_u1(RESOLVE_TABLE(decodeTab).values, symbolLow);
+  if ((high == 0xFF) || (low == 0xFF)) {
+    return false;
+  }
+  decoded = (high << 4) | low;
+  return true;
+}
+
+#else
+
+using DecodeTable = Table<uint16_t, 4096>;
+
+constexpr DecodeTable makeDecodeTab() {
+  DecodeTable tab = {};
+  for (uint16_t symbols = 0; symbols < 4096; symbols++) {
+    const uint8_t high = decodeSymbol(symbols >> 6);
+    const uint8_t low = decodeSymbol(symbols & 0x3F);
+    tab.values[symbols] = (high == 0xFF || low == 0xFF) ? 0xFFFF : ((high << 4) | low);
+  }
+  return tab;
+}
+
+constexpr uint16_t countValid(const DecodeTable &tab) {
+  uint16_t count = 0;
+  for (uint16_t symbols = 0; symbols < 4096; symbols++) {
+    count += tab.values[symbols] != 0xFFFF;
+  }
+  return count;
+}
+
+static_assert(countValid(makeDecodeTab()) == 256, "exactly 256 valid symbol pairs");
+static_assert(makeDecodeTab().values[(0x16 << 6) | 0x29] == 0x0F, "decoding table does not match EN 13757-4");
+
+// Table for decoding two 6-bit "3 out of 6" encoded data into a byte.
+// The value 0xFFFF indicates invalid "3 out of 6" coding
+CONST_TABLE(DecodeTable, decodeTab) = makeDecodeTab();
+
+// Decode 2 symbols into a byte, first symbol is the high nibble.
+// Return false if one of the symbol is invalid
+inline bool decodeByte(uint8_t symbolHigh, uint8_t symbolLow, uint8_t &decoded) {
+  const uint16_t value = table_get_u2(RESOLVE_TABLE(decodeTab).values, (symbolHigh << 6) | symbolLow);
+  if (value == 0xFFFF) {
+    return false;
+  }
+  decoded = value;
+  return true;
+}
+
+#endif
+
+} // namespace
 
 // Performs the "3 out 6" decoding of a 24-bit data value into 16-bit
 // data value. If only 2 byte left to decoded,
 // the postamble sequence is ignored
 bool decode3outof6(const uint8_t *encodedData, uint8_t *decodedData, bool lastByte) {
-
-  std::array<uint8_t, 2> data = {
-    decodeTab[((encodedData[1] & 0xF0) >> 4) | ((encodedData[0] & 0x03) << 4)],
-    decodeTab[((encodedData[0] & 0xFC) >> 2)]
-  };
+  PROFILE_SCOPE(Decode3outof6);
 
   // - Check for invalid data coding -
-  if ((data[0] == 0xFF) || (data[1] == 0xFF)) {
+  if (!decodeByte((encodedData[0] & 0xFC) >> 2, ((encodedData[1] & 0xF0) >> 4) | ((encodedData[0] & 0x03) << 4),
+                  decodedData[0])) {
     return false;
   }
 
-  decodedData[0] = (data[1] << 4) | (data[0]);
-
   if (!lastByte) {
-    data[0] = decodeTab[encodedData[2] & 0x3F];
-    data[1] = decodeTab[((encodedData[2] & 0xC0) >> 6) | ((encodedData[1] & 0x0F) << 2)];
     // - Check for invalid data coding -
-    if ((data[0] == 0xFF) || (data[1] == 0xFF)) {
+    if (!decodeByte(((encodedData[2] & 0xC0) >> 6) | ((encodedData[1] & 0x0F) << 2), encodedData[2] & 0x3F,
+                    decodedData[1])) {
       return false;
     }
-    decodedData[1] = (data[1] << 4) | (data[0]);
   }
 
   return true;
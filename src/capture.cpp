@@ -0,0 +1,27 @@
+#include "capture.h"
+#include <lmic/bufferpack.h>
+#include <stdio.h>
+
+void CaptureHeader::write(uint8_t *out) const {
+  wlsbf4(out, time_ms);
+  out[4] = rssi;
+  out[5] = static_cast<uint8_t>(mode);
+  out[6] = length;
+}
+
+CaptureHeader CaptureHeader::read(const uint8_t *in) {
+  return {rlsbf4(in), in[4], static_cast<WMBusMode>(in[5]), in[6]};
+}
+
+void printCapture(const CaptureHeader &header, const uint8_t *raw) {
+  uint8_t head[CAPTURE_HEADER_SIZE];
+  header.write(head);
+  printf("%s", CAPTURE_PREFIX);
+  for (uint8_t i = 0; i < CAPTURE_HEADER_SIZE; i++) {
+    printf("%02X", head[i]);
+  }
+  for (uint8_t i = 0; i < header.length; i++) {
+    printf("%02X", raw[i]);
+  }
+  printf("\n");
+}
@@ -0,0 +1,31 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+#include <stdint.h>
+
+#include "mbus_packet.h"
+
+// Capture of a raw frame as read from the radio FIFO (before decoding).
+// Record format, multi-byte values are little endian:
+//  |    0-3    |  4   |  5   |   6    | 7 ... |
+//  | time (ms) | rssi | mode | length |  raw  |
+// rssi is the value of RegRssiValue (-rssi/2 dBm), mode is a WMBusMode.
+//
+// A capture file is a sequence of records. In debug build the firmware
+// prints each record in hexadecimal on a line starting with CAPTURE_PREFIX.
+
+constexpr uint8_t CAPTURE_HEADER_SIZE = 7;
+constexpr char CAPTURE_PREFIX[] = "CAPTURE ";
+
+struct CaptureHeader {
+  uint32_t time_ms;
+  uint8_t rssi;
+  WMBusMode mode;
+  uint8_t length;
+
+  void write(uint8_t *out) const;
+  static CaptureHeader read(const uint8_t *in);
+};
+
+void printCapture(const CaptureHeader &header, const uint8_t *raw);
+
+#endif
@@ -0,0 +1,94 @@
+#include "consumption.h"
+
+#include <lmic/bufferpack.h>
+
+namespace {
+// The flow is continuous if the index never stays constant for this time
+constexpr uint32_t LEAK_QUIET_TIME = 3600;
+// A continuous flow during this time is a leak
+constexpr uint32_t LEAK_DURATION = 24 * 3600UL;
+
+constexpr uint8_t FLOW_FRACTION_BITS = 4;
+
+// Flow in 1/16 L/h of volume liters in elapsed seconds, saturated
+uint16_t flowOf(uint32_t volume, uint32_t elapsed) {
+  // keep volume * 3600 * 16 in 32 bits
+  if (volume > 0xFFFF) {
+    return 0xFFFF;
+  }
+  const uint32_t flow = volume * (3600UL << FLOW_FRACTION_BITS) / elapsed;
+  return flow > 0xFFFF ? 0xFFFF : flow;
+}
+
+uint32_t saturatedAdd(uint32_t value, uint32_t add) { return value > 0xFFFFFFFF - add ? 0xFFFFFFFF : value + add; }
+
+} // namespace
+
+void Consumption::addReading(uint32_t index, uint32_t elapsed) {
+  readings += readings < 0xFF;
+  if (!started) {
+    started = true;
+    lastIndex = index;
+    intervalStartIndex = index;
+    return;
+  }
+  if (elapsed == 0) {
+    return;
+  }
+
+  if (index < lastIndex) {
+    // meter installed in reverse or index reset
+    status |= CONSUMPTION_BACKFLOW;
+    lastIndex = index;
+    intervalStartIndex = index;
+    return;
+  }
+
+  const uint32_t volume = index - lastIndex;
+  lastIndex = index;
+  addFlow(flowOf(volume, elapsed));
+
+  if (volume == 0) {
+    quietTime = saturatedAdd(quietTime, elapsed);
+  } else {
+    quietTime = 0;
+  }
+  if (quietTime >= LEAK_QUIET_TIME) {
+    continuousFlowTime = 0;
+    status &= ~CONSUMPTION_LEAK;
+    leakSent = false;
+    return;
+  }
+  continuousFlowTime = saturatedAdd(continuousFlowTime, elapsed);
+  if (continuousFlowTime >= LEAK_DURATION) {
+    status |= CONSUMPTION_LEAK;
+  }
+}
+
+void Consumption::addFlow(uint16_t flow) {
+  if (flow < minFlow) {
+    minFlow = flow;
+  }
+  if (flow > maxFlow) {
+    maxFlow = flow;
+  }
+}
+
+void Consumption::summary(uint8_t *buffer) {
+  const uint32_t volume = lastIndex - intervalStartIndex;
+  wlsbf4(buffer, lastIndex);
+  wlsbf2(buffer + 4, volume > 0xFFFF ? 0xFFFF : volume);
+  // no flow computed in the interval
+  wlsbf2(buffer + 6, minFlow > maxFlow ? 0 : minFlow);
+  wlsbf2(buffer + 8, maxFlow);
+  buffer[10] = status;
+  buffer[11] = readings;
+
+  intervalStartIndex = lastIndex;
+  minFlow = 0xFFFF;
+  maxFlow = 0;
+  readings = 0;
+  // the leak flag stays set until the flow stops, the backflow flag is sent once
+  status &= ~CONSUMPTION_BACKFLOW;
+  leakSent = leak();
+}
@@ -0,0 +1,49 @@
+#ifndef CONSUMPTION_H
+#define CONSUMPTION_H
+
+#include <stdint.h>
+
+// Consumption statistics computed on the node from the successive meter
+// index, to send a summary instead of each reading.
+// Index are in liters, flow are in liters per hour with 4 bits of fraction
+// (1/16 L/h, up to 4095 L/h).
+
+// Size of the summary written by Consumption::summary()
+constexpr uint8_t CONSUMPTION_SUMMARY_SIZE = 12;
+
+// status bits of the summary
+constexpr uint8_t CONSUMPTION_LEAK = 0x01;
+constexpr uint8_t CONSUMPTION_BACKFLOW = 0x02;
+
+class Consumption final {
+public:
+  // Add a reading, elapsed is the number of seconds since the previous reading
+  void addReading(uint32_t index, uint32_t elapsed);
+
+  // Write the summary of the current interval (CONSUMPTION_SUMMARY_SIZE bytes) and start a new interval
+  //  |  0-3  |      4-5     |   6-7    |   8-9    |   10   |    11    |
+  //  | index | volume (L)   | min flow | max flow | status | readings |
+  void summary(uint8_t *buffer);
+
+  bool leak() const { return status & CONSUMPTION_LEAK; }
+  // Leak detected since the last summary
+  bool newLeak() const { return leak() && !leakSent; }
+
+private:
+  void addFlow(uint16_t flow);
+
+  uint32_t lastIndex = 0;
+  uint32_t intervalStartIndex = 0;
+  // seconds since the index last stayed constant for LEAK_QUIET_TIME
+  uint32_t continuousFlowTime = 0;
+  // seconds since the last change of index
+  uint32_t quietTime = 0;
+  uint16_t minFlow = 0xFFFF;
+  uint16_t maxFlow = 0;
+  uint8_t status = 0;
+  uint8_t readings = 0;
+  bool leakSent = false;
+  bool started = false;
+};
+
+#endif
@@ -1,15 +1,70 @@
 #include "crc.h"
+#include <lmic/lmic_table.h>
 
-// Calculates the 16-bit CRC. The function requires that the CRC_POLYNOM is
-// defined, which gives the wanted CRC polynom.
-void CrcCalc::pushData(uint8_t data) {
-  for (uint8_t i = 0; i < 8; i++) {
-    // If upper most bit is 1
-    if (((reg & 0x8000) >> 8) ^ (data & 0x80))
-      reg = (reg << 1) ^ CRC_POLYNOM;
-    else
-      reg = (reg << 1);
-
-    data <<= 1;
+#include "profiling.h"
+
+// Number of data bits processed per table lookup:
+//  - 4 : 16 entries table (32 bytes), two lookups per byte
+//  - 8 : 256 entries table (512 bytes), one lookup per byte
+#ifndef CRC_TABLE_BITS
+#define CRC_TABLE_BITS 4
+#endif
+
+static_assert(CRC_TABLE_BITS == 4 || CRC_TABLE_BITS == 8, "CRC_TABLE_BITS must be 4 or 8");
+
+namespace {
+
+constexpr uint8_t TABLE_SIZE = (1 << CRC_TABLE_BITS) - 1;
+
+// CRC register after shifting the upper bits of value through the polynom
+constexpr uint16_t crcShift(uint16_t value, uint8_t nbBits) {
+  for (uint8_t i = 0; i < nbBits; i++) {
+    value = (value & 0x8000) ? (value << 1) ^ CrcCalc::CRC_POLYNOM : (value << 1);
+  }
+  return value;
+}
+
+struct CrcTable {
+  uint16_t values[TABLE_SIZE + 1];
+};
+
+constexpr CrcTable makeCrcTable() {
+  CrcTable tab = {};
+  for (uint16_t i = 0; i <= TABLE_SIZE; i++) {
+    tab.values[i] = crcShift(i << (16 - CRC_TABLE_BITS), CRC_TABLE_BITS);
   }
+  return tab;
+}
+
+// CRC of a string computed with the table, to check the table against the
+// CRC-16/EN-13757 reference value
+constexpr uint16_t crcCheckValue(const char *data) {
+  const CrcTable tab = makeCrcTable();
+  uint16_t reg = 0;
+  for (; *data != 0; data++) {
+    for (uint8_t shift = 8; shift > 0; shift -= CRC_TABLE_BITS) {
+      const uint8_t bits = (static_cast<uint8_t>(*data) >> (shift - CRC_TABLE_BITS)) & TABLE_SIZE;
+      reg = (reg << CRC_TABLE_BITS) ^ tab.values[(reg >> (16 - CRC_TABLE_BITS)) ^ bits];
+    }
+  }
+  return ~reg;
+}
+static_assert(crcCheckValue("123456789") == 0xC2B7, "CRC table does not match CRC-16/EN-13757");
+
+CONST_TABLE(CrcTable, crcTable) = makeCrcTable();
+
+inline uint16_t crcTableGet(uint8_t index) { return table_get_u2(RESOLVE_TABLE(crcTable).values, index); }
+
+} // namespace
+
+// Calculates the 16-bit CRC with the CRC_POLYNOM polynom,
+// CRC_TABLE_BITS bits at a time.
+void CrcCalc::pushData(uint8_t data) {
+  PROFILE_SCOPE(CrcPushData);
+#if CRC_TABLE_BITS == 8
+  reg = (reg << 8) ^ crcTableGet((reg >> 8) ^ data);
+#else
+  reg = (reg << 4) ^ crcTableGet((reg >> 12) ^ (data >> 4));
+  reg = (reg << 4) ^ crcTableGet((reg >> 12) ^ (data & 0x0F));
+#endif
 }
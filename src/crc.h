@@ -3,14 +3,16 @@
 #include <stdint.h>
 
 class CrcCalc final {
-  static constexpr uint16_t CRC_POLYNOM = 0x3D65;
-
   uint16_t reg = 0;
 
 public:
+  static constexpr uint16_t CRC_POLYNOM = 0x3D65;
+
   void pushData(uint8_t data);
   bool checkLow(uint8_t crcLow) const { return (~reg & 0xff) == crcLow; };
   bool checkHigh(uint8_t crcHigh) const { return (((~reg) >> 8) & 0xff) == crcHigh; };
+  // CRC field value (high byte is sent first)
+  uint16_t value() const { return ~reg; };
 };
 
 #endif
\ No newline at end of file
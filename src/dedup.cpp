@@ -0,0 +1,39 @@
+#include "dedup.h"
+
+#include <algorithm>
+#include <lmic/bufferpack.h>
+
+bool DedupCache::accept(const uint8_t *id, uint16_t crc, const std::array<uint8_t, 7> &reading, OsTime now) {
+  // identification number, the version and type are the same for a meter
+  const uint32_t meter = rlsbf4(id);
+
+  Entry *entry = nullptr;
+  for (auto &candidate : entries) {
+    if (candidate.used && candidate.id == meter) {
+      entry = &candidate;
+      break;
+    }
+  }
+
+  if (entry) {
+    const bool recent = now - entry->time < OsDeltaTime::from_sec(DEDUP_MAX_AGE);
+    if (recent && (entry->crc == crc || std::equal(reading.begin(), reading.end(), entry->reading.begin()))) {
+      return false;
+    }
+  } else {
+    // replace a free entry or the oldest one
+    entry = &entries[0];
+    for (auto &candidate : entries) {
+      if (!candidate.used) {
+        entry = &candidate;
+        break;
+      }
+      if (candidate.time < entry->time) {
+        entry = &candidate;
+      }
+    }
+  }
+
+  *entry = {meter, crc, reading, now, true};
+  return true;
+}
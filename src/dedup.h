@@ -0,0 +1,38 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <array>
+#include <lmic/oslmic.h>
+#include <stdint.h>
+
+// Last telegram forwarded for each meter, to drop the repeated ones.
+// A telegram is a duplicate if it has the same CRC or the same reading
+// (flags and index) than the last one forwarded for the meter less than
+// DEDUP_MAX_AGE seconds ago. After this time a reading is forwarded even
+// if it did not change.
+
+#ifndef DEDUP_CACHE_SIZE
+#define DEDUP_CACHE_SIZE 2
+#endif
+#ifndef DEDUP_MAX_AGE
+#define DEDUP_MAX_AGE 3600
+#endif
+
+class DedupCache final {
+public:
+  // Return true if the telegram must be forwarded and record it.
+  // id is the A field of the frame, crc the last CRC field.
+  bool accept(const uint8_t *id, uint16_t crc, const std::array<uint8_t, 7> &reading, OsTime now);
+
+private:
+  struct Entry {
+    uint32_t id;
+    uint16_t crc;
+    std::array<uint8_t, 7> reading;
+    OsTime time;
+    bool used;
+  };
+  std::array<Entry, DEDUP_CACHE_SIZE> entries = {};
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "eventlog.h"
+
+#if LMIC_DEBUG_LEVEL > 0
+
+#include <hal/print_debug.h>
+#include <lmic/bufferpack.h>
+#include <lmic/oslmic.h>
+#include <stdio.h>
+
+#include "capture.h"
+
+namespace {
+// event: | id | length | time since the previous event (ms, lsb, at most 0xFFFF) | arguments |
+constexpr uint8_t EVENT_HEADER_SIZE = 4;
+uint8_t ring[EVENTLOG_SIZE];
+uint16_t head = 0;
+uint16_t used = 0;
+uint8_t lost = 0;
+// time of the oldest and of the newest stored event
+OsTime firstTime;
+OsTime lastTime;
+
+static_assert(EVENTLOG_SIZE >= EVENT_HEADER_SIZE + EVENTLOG_MAX_ARGS, "EVENTLOG_SIZE must hold the longest event");
+static_assert(EVENTLOG_SIZE <= 0x8000, "EVENTLOG_SIZE must fit in uint16_t");
+
+void push(const uint8_t *data, uint8_t size) {
+  for (uint8_t i = 0; i < size; i++) {
+    ring[(head + used) % EVENTLOG_SIZE] = data[i];
+    used++;
+  }
+}
+
+uint8_t pop() {
+  const uint8_t value = ring[head];
+  head = (head + 1) % EVENTLOG_SIZE;
+  used--;
+  return value;
+}
+
+void printHex(const uint8_t *data, uint8_t size) {
+  for (uint8_t i = 0; i < size; i++) {
+    printf("%02X", data[i]);
+  }
+}
+
+void printEvent(EventId id, const uint8_t *args, uint8_t size) {
+  switch (id) {
+  case EventId::ListenStart:
+    PRINT_DEBUG(1, F("Start listen wmbus"));
+    break;
+  case EventId::RadioState:
+    PRINT_DEBUG(1, F("State %02x, IRQ1 %02x, IRQ2 %02x, current_raw_byte %d"), args[0], args[1], args[2], args[3]);
+    break;
+  case EventId::FifoOverrun:
+    PRINT_DEBUG(1, F("Fifo overrun"));
+    break;
+  case EventId::FifoFull:
+    PRINT_DEBUG(1, F("Fifo full"));
+    break;
+  case EventId::PreambleDetect:
+    PRINT_DEBUG(1, F("Preamble detect"));
+    break;
+  case EventId::Capture:
+    printCapture(CaptureHeader::read(args), args + CAPTURE_HEADER_SIZE);
+    break;
+  case EventId::DecodeResult:
+    PRINT_DEBUG(1, F("decode packet %d "), args[0]);
+    break;
+  case EventId::IzarId:
+    printf("ID: ");
+    printHex(args, size);
+    printf("\n");
+    break;
+  case EventId::IzarReading: {
+    const uint32_t idx = rlsbf4(args + 3);
+    printf("Status: ");
+    printHex(args, 3);
+    printf(" Idx: %ld.%ld\n", idx / 1000L, idx % 1000L);
+  } break;
+  case EventId::ListenStop:
+    PRINT_DEBUG(1, F("Stopping listen WMBUS"));
+    break;
+  case EventId::Duplicate:
+    PRINT_DEBUG(1, F("WMBUS duplicate"));
+    break;
+  default:
+    PRINT_DEBUG(1, F("Event %d"), static_cast<uint8_t>(id));
+    break;
+  }
+}
+
+} // namespace
+
+bool logEvent(EventId id, const uint8_t *data, uint8_t size, const uint8_t *data2, uint8_t size2) {
+  const uint8_t length = size + size2;
+  if (length > EVENTLOG_MAX_ARGS || EVENTLOG_SIZE - used < length + EVENT_HEADER_SIZE) {
+    if (lost < 255)
+      lost++;
+    return false;
+  }
+  const OsTime now = os_getTime();
+  if (used == 0) {
+    firstTime = now;
+    lastTime = now;
+  }
+  const int32_t delta = (now - lastTime).to_ms();
+  lastTime = now;
+  uint8_t header[EVENT_HEADER_SIZE] = {static_cast<uint8_t>(id), length};
+  wlsbf2(header + 2, delta < 0xFFFF ? delta : 0xFFFF);
+  push(header, EVENT_HEADER_SIZE);
+  push(data, size);
+  push(data2, size2);
+  return true;
+}
+
+void printEventLog() {
+  uint8_t args[EVENTLOG_MAX_ARGS];
+  OsTime time = firstTime;
+  while (used > 0) {
+    const EventId id = static_cast<EventId>(pop());
+    const uint8_t size = pop();
+    uint16_t delta = pop();
+    delta |= pop() << 8;
+    time = time + OsDeltaTime::from_ms(delta);
+    for (uint8_t i = 0; i < size; i++) {
+      args[i] = pop();
+    }
+    printf("[-%ld ms] ", static_cast<long>((os_getTime() - time).to_ms()));
+    printEvent(id, args, size);
+  }
+  if (lost > 0) {
+    PRINT_DEBUG(1, F("%d events lost"), lost);
+    lost = 0;
+  }
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stdint.h>
+
+// Debug events are stored in binary form (id, length, time since the previous
+// event, arguments) in a ring buffer and formatted only by printEventLog(),
+// called when the node is idle and between RX calibration windows. It keeps
+// the serial output (9600 baud) out of the reception path. Each event is
+// printed with its age, the time between the event and its print.
+// With LMIC_DEBUG_LEVEL = 0 all functions are empty.
+
+// Size of the ring buffer in bytes. A 60 s listen window logs about 150 bytes
+// (a RadioState and a PreambleDetect every 5 s), a T1 frame 80 bytes (Capture,
+// DecodeResult, IzarId and IzarReading): the default keeps a window and a frame.
+#ifndef EVENTLOG_SIZE
+#define EVENTLOG_SIZE 256
+#endif
+// Longest arguments of an event (capture header and T1 frame)
+constexpr uint8_t EVENTLOG_MAX_ARGS = 64;
+
+enum class EventId : uint8_t {
+  // no argument
+  ListenStart = 1,
+  // opmode, irq flags 1, irq flags 2, number of bytes read
+  RadioState,
+  // no argument
+  FifoOverrun,
+  FifoFull,
+  PreambleDetect,
+  // capture header + raw frame (see capture.h)
+  Capture,
+  // PacketDecodeResult
+  DecodeResult,
+  // A field
+  IzarId,
+  // status flags (3 bytes), index (4 bytes lsb)
+  IzarReading,
+  // no argument
+  ListenStop,
+  // frame of the meter already forwarded
+  Duplicate,
+};
+
+#if LMIC_DEBUG_LEVEL > 0
+// Store an event with size + size2 bytes of arguments (at most EVENTLOG_MAX_ARGS),
+// return false if there is no space left
+bool logEvent(EventId id, const uint8_t *data = nullptr, uint8_t size = 0, const uint8_t *data2 = nullptr,
+              uint8_t size2 = 0);
+// Print and remove all stored events
+void printEventLog();
+#else
+inline bool logEvent(EventId, const uint8_t * = nullptr, uint8_t = 0, const uint8_t * = nullptr, uint8_t = 0) {
+  return true;
+}
+inline void printEventLog() {}
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef FRAME_LAYOUT_H
+#define FRAME_LAYOUT_H
+#include <stdint.h>
+
+// Compile time description of a wireless MBUS frame with a fixed length.
+// Field index are given in the frame without the CRC fields:
+//  | 0 | 1 | 2-3 | 4-9 | 10 | ...
+//  | L | C |  M  |  A  | CI | ...
+
+/// @brief Frame format A: a first block of 10 bytes (L, C, M and A fields)
+/// then blocks of 16 bytes (the last one can be shorter), each block is
+/// followed by 2 bytes of CRC.
+/// @tparam L_FIELD Value of the L-field of the frame
+/// @tparam CI_INDEX Index of the CI field
+/// @tparam ENCRYPTED_INDEX Index of the first encrypted byte
+/// @tparam ENCRYPTED_LENGTH Number of encrypted bytes
+template <uint8_t L_FIELD, uint8_t CI_INDEX, uint8_t ENCRYPTED_INDEX, uint8_t ENCRYPTED_LENGTH> struct FrameLayoutA {
+  static constexpr uint8_t lField = L_FIELD;
+  static constexpr uint8_t firstBlockLength = 10;
+  static constexpr uint8_t blockLength = 16;
+  // Number of bytes without the CRC fields
+  static constexpr uint16_t dataLength = lField + 1;
+  static_assert(dataLength > firstBlockLength, "frame must contain more than the first block");
+  static constexpr uint8_t nbBlocks = 1 + (dataLength - firstBlockLength + blockLength - 1) / blockLength;
+  // Number of bytes in the decoded frame
+  static constexpr uint16_t size = dataLength + 2 * nbBlocks;
+  // Number of bytes of the "3 out of 6" encoded frame (T mode)
+  static constexpr uint16_t encodedSize = (size * 3 + 1) / 2;
+
+  /// @brief Position in the frame of the byte at index (CRC fields excluded)
+  static constexpr uint16_t offset(uint16_t index) {
+    return index < firstBlockLength ? index : index + 2 * (1 + (index - firstBlockLength) / blockLength);
+  }
+  /// @brief Position in the frame of the first byte of a block
+  static constexpr uint16_t blockOffset(uint8_t block) {
+    return block == 0 ? 0 : firstBlockLength + 2 + (block - 1) * (blockLength + 2);
+  }
+  /// @brief Number of bytes in a block (CRC excluded)
+  static constexpr uint8_t blockDataLength(uint8_t block) {
+    return block == 0                ? firstBlockLength
+           : block + 1 == nbBlocks ? dataLength - firstBlockLength - (nbBlocks - 2) * blockLength
+                                     : blockLength;
+  }
+
+  static constexpr uint16_t ciOffset = offset(CI_INDEX);
+  static constexpr uint16_t encryptedOffset = offset(ENCRYPTED_INDEX);
+  static constexpr uint8_t encryptedLength = ENCRYPTED_LENGTH;
+  static_assert(offset(ENCRYPTED_INDEX + ENCRYPTED_LENGTH - 1) == encryptedOffset + ENCRYPTED_LENGTH - 1,
+                "encrypted part must not contain a CRC field");
+  static_assert(ENCRYPTED_INDEX + ENCRYPTED_LENGTH <= dataLength, "encrypted part outside of the frame");
+};
+
+/// @brief Frame format B (C mode only): a first block of 10 bytes (L, C, M and A fields)
+/// without CRC, a second block up to 128 bytes ending with a CRC covering the two first
+/// blocks, and an optional third block with its own CRC. The L-field includes the CRC fields.
+/// @tparam L_FIELD Value of the L-field of the frame
+/// @tparam CI_INDEX Index of the CI field
+/// @tparam ENCRYPTED_INDEX Index of the first encrypted byte
+/// @tparam ENCRYPTED_LENGTH Number of encrypted bytes
+template <uint8_t L_FIELD, uint8_t CI_INDEX, uint8_t ENCRYPTED_INDEX, uint8_t ENCRYPTED_LENGTH> struct FrameLayoutB {
+  static constexpr uint8_t lField = L_FIELD;
+  static constexpr uint8_t firstBlockLength = 10;
+  // Maximum size of first and second block including CRC
+  static constexpr uint8_t secondBlockEnd = 128;
+  // Number of bytes in the decoded frame
+  static constexpr uint16_t size = lField + 1;
+  static_assert(size > firstBlockLength + 2, "frame must contain more than the first block");
+  static constexpr uint8_t nbBlocks = size > secondBlockEnd ? 2 : 1;
+  static constexpr uint16_t dataLength = size - 2 * nbBlocks;
+
+  /// @brief Position in the frame of the byte at index (CRC fields excluded)
+  static constexpr uint16_t offset(uint16_t index) { return index < secondBlockEnd - 2 ? index : index + 2; }
+  /// @brief Position in the frame of the first byte of a block covered by a CRC
+  static constexpr uint16_t blockOffset(uint8_t block) { return block == 0 ? 0 : secondBlockEnd; }
+  /// @brief Number of bytes in a block covered by a CRC (CRC excluded)
+  static constexpr uint8_t blockDataLength(uint8_t block) {
+    return block == 0 ? (nbBlocks == 1 ? size : secondBlockEnd) - 2 : size - secondBlockEnd - 2;
+  }
+
+  static constexpr uint16_t ciOffset = offset(CI_INDEX);
+  static constexpr uint16_t encryptedOffset = offset(ENCRYPTED_INDEX);
+  static constexpr uint8_t encryptedLength = ENCRYPTED_LENGTH;
+  static_assert(offset(ENCRYPTED_INDEX + ENCRYPTED_LENGTH - 1) == encryptedOffset + ENCRYPTED_LENGTH - 1,
+                "encrypted part must not contain a CRC field");
+  static_assert(ENCRYPTED_INDEX + ENCRYPTED_LENGTH <= dataLength, "encrypted part outside of the frame");
+};
+
+// IZAR / PRIOS frame
+//  | 10 |    11-13     |  14  |       15-25       |
+//  | CI | status flags | unit | encrypted payload |
+using IzarLayout = FrameLayoutA<0x19, 10, 15, 11>;
+static_assert(IzarLayout::size == 30, "IZAR frame is 30 bytes long");
+static_assert(IzarLayout::ciOffset == 12, "IZAR CI field is after the first CRC");
+// Same content in frame format B (C1 mode)
+using IzarLayoutB = FrameLayoutB<0x1B, 10, 15, 11>;
+static_assert(IzarLayoutB::size == 28, "IZAR frame format B is 28 bytes long");
+
+#endif
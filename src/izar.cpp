@@ -3,83 +3,67 @@
 #include <array>
 #include <lmic/bufferpack.h>
 #include <stdint.h>
-#include <stdio.h>
 
-bool decodeDiehlLfsr(const uint8_t *const origin, uint8_t *const decoded, const uint16_t size, uint32_t key);
-
-void printHex(const uint8_t *packet, const uint8_t length) {
-  for (uint8_t i = 0; i < length; i++) {
-    printf("%02X", packet[i]);
-  }
-}
+#include "eventlog.h"
+#include "profiling.h"
 
 // assume only one frame
-// Print and extract data with a lot of hardcoded values
+// Log and extract data, frame position come from the Layout
+template <typename Layout>
 bool printAndExtractIZAR(const uint8_t *packet, const uint8_t length, const std::array<uint8_t, 6> &wantedId,
-                         std::array<uint8_t, 7> &result) {
+                         std::array<uint8_t, 7> &result, uint32_t key) {
   // L field
-  if (packet[0] != 0x19 && length != 30) {
+  if (packet[0] != Layout::lField || length < Layout::size) {
     return false;
   }
   // C Field : periodic data brodcat
-  if (packet[1] != 0x44) {
+  if (packet[Layout::offset(1)] != 0x44) {
     return false;
   }
 
   // M field SAP
-  if (packet[2] != 0x30 && packet[3] != 0x4C) {
+  if (packet[Layout::offset(2)] != 0x30 || packet[Layout::offset(3)] != 0x4C) {
     return false;
   }
 
   // A field :  ID +dim
-  if (LMIC_DEBUG_LEVEL > 0) {
-    printf("ID: ");
-    printHex(&packet[4], 6);
-  }
+  logEvent(EventId::IzarId, &packet[Layout::offset(4)], 6);
 
-  // CRC byte 10 et 11
-  // CI byte 12 = 0xA1 PRIOS
-  if (packet[2 + 10] != 0xA1) {
+  // CI = 0xA1 PRIOS
+  if (packet[Layout::ciOffset] != 0xA1) {
     return false;
   }
 
-  if (LMIC_DEBUG_LEVEL > 0) {
-    printf(" Status: ");
-    printHex(&packet[2 + 11], 3);
-  }
-  std::copy_n(packet + 2 + 11, 3, result.begin());
-  //  2+14 : unit in liters
-  if (packet[2 + 14] != 0x13) {
+  std::copy_n(packet + Layout::ciOffset + 1, 3, result.begin());
+  // unit in liters
+  if (packet[Layout::ciOffset + 4] != 0x13) {
     return false;
   }
 
-  // coded part [2+15] to [2+26] 11 bytes
-  uint32_t key = 0x39BC8A10 ^ 0xE66D83F8;
-  uint8_t decoded[11];
-  if (!decodeDiehlLfsr(packet, decoded, 11, key)) {
+  // coded part
+  uint8_t decoded[Layout::encryptedLength];
+  if (!decodeDiehlLfsr<Layout>(packet, decoded, key)) {
     return false;
   }
 
-  if (LMIC_DEBUG_LEVEL > 0) {
-    uint32_t idx = rlsbf4(decoded + 1);
-    printf(" Idx: %ld.%ld", idx / 1000L, idx % 1000L);
-  }
   std::copy_n(decoded + 1, 4, result.begin() + 3);
+  logEvent(EventId::IzarReading, result.begin(), result.size());
 
   // return true only if it is the wanted counter
-  return std::equal(wantedId.cbegin(), wantedId.cend(), packet + 4);
+  return std::equal(wantedId.cbegin(), wantedId.cend(), packet + Layout::offset(4));
 }
 
-bool decodeDiehlLfsr(const uint8_t *const origin, uint8_t *const decoded, const uint16_t size, uint32_t key) {
+template <typename Layout> bool decodeDiehlLfsr(const uint8_t *const origin, uint8_t *const decoded, uint32_t key) {
+  PROFILE_SCOPE(DiehlLfsr);
   // modify seed key with header values
   // manufacturer + address[0-1]
-  key ^= rmsbf4(origin + 2);
+  key ^= rmsbf4(origin + Layout::offset(2));
   // address[2-3] + version + type
-  key ^= rmsbf4(origin + 6);
+  key ^= rmsbf4(origin + Layout::offset(6));
   // ci + some more bytes from the telegram...
-  key ^= rmsbf4(origin + 2 + 10);
+  key ^= rmsbf4(origin + Layout::ciOffset);
 
-  for (uint16_t i = 0; i < size; ++i) {
+  for (uint8_t i = 0; i < Layout::encryptedLength; ++i) {
     // calculate new key (LFSR)
     // https://en.wikipedia.org/wiki/Linear-feedback_shift_register
     for (int j = 0; j < 8; ++j) {
@@ -89,8 +73,17 @@ bool decodeDiehlLfsr(const uint8_t *const origin, uint8_t *const decoded, const
       key = (key << 1) | bit;
     }
     // decode i-th content byte with fresh/last 8-bits of key
-    decoded[i] = origin[i + 15 + 2] ^ (key & 0xFF);
+    decoded[i] = origin[i + Layout::encryptedOffset] ^ (key & 0xFF);
   }
   // check-byte does match
   return decoded[0] == 0x4B;
 }
+
+template bool decodeDiehlLfsr<IzarLayout>(const uint8_t *const origin, uint8_t *const decoded, uint32_t key);
+template bool decodeDiehlLfsr<IzarLayoutB>(const uint8_t *const origin, uint8_t *const decoded, uint32_t key);
+template bool printAndExtractIZAR<IzarLayout>(const uint8_t *packet, const uint8_t length,
+                                              const std::array<uint8_t, 6> &wantedId, std::array<uint8_t, 7> &result,
+                                              uint32_t key);
+template bool printAndExtractIZAR<IzarLayoutB>(const uint8_t *packet, const uint8_t length,
+                                               const std::array<uint8_t, 6> &wantedId, std::array<uint8_t, 7> &result,
+                                               uint32_t key);
@@ -4,11 +4,22 @@
 #include <array>
 #include <stdint.h>
 
+#include "frame_layout.h"
+
 // result format
 //  |   0    |   1    |   2    | 3 | 4 | 5 | 6 |
 //  | flag 0 | flag 1 | flag 2 | index lsb     |
 
+// Default key of Diehl meters, some meters use another one (see tools/keysearch)
+constexpr uint32_t DIEHL_DEFAULT_KEY = 0x39BC8A10 ^ 0xE66D83F8;
+
+// Instantiated for IzarLayout and IzarLayoutB
+template <typename Layout>
 bool printAndExtractIZAR(const uint8_t *packet, const uint8_t length, const std::array<uint8_t, 6> &wantedId,
-                         std::array<uint8_t, 7> &result);
+                         std::array<uint8_t, 7> &result, uint32_t key = DIEHL_DEFAULT_KEY);
+
+// Decode (or encode) the encrypted part of the frame, return true if the check byte match.
+// Instantiated for IzarLayout and IzarLayoutB
+template <typename Layout> bool decodeDiehlLfsr(const uint8_t *const origin, uint8_t *const decoded, uint32_t key);
 
-#endif
\ No newline at end of file
+#endif
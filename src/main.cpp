@@ -9,20 +9,49 @@
 #include <lmic.h>
 
 #include <algorithm>
+#include <type_traits>
+#include <utility>
 #include <sleepandwatchdog.h>
 
 #define DEVICE_TEMP1
+#include "consumption.h"
+#include "eventlog.h"
+#include "power_governor.h"
+#include "profiling.h"
 #include "lorakeys.h"
-#include "powersave.h"
 #include "radio1276FSK.h"
+#include "radio_scheduler.h"
+#include "resume.h"
+#include "rx_profile.h"
+#include "uplink_queue.h"
+#include "wmbus_hal_avr.h"
 
 constexpr unsigned int EEPROMVKEY = 0x51;
+// The LMIC state (frame counters) is saved every SEQNO_SAVE_INTERVAL uplinks to spare
+// the EEPROM, the uplink counter is advanced by as much when it is restored.
+constexpr uint32_t SEQNO_SAVE_INTERVAL = 0x40;
 
 // Schedule TX every this many seconds (might become longer due to duty
 // cycle limitations).
 // if possible a little before the interval of send of the meter
 
 constexpr OsDeltaTime TX_INTERVAL = OsDeltaTime::from_sec(604);
+// Battery is measured at most every VCC_SAMPLE_INTERVAL while idle (see power_governor.h)
+constexpr OsDeltaTime VCC_SAMPLE_INTERVAL = OsDeltaTime::from_sec(60);
+
+// With SEND_CONSUMPTION_SUMMARY defined, readings are aggregated (see consumption.h)
+// and a summary is sent on port 21 every SUMMARY_INTERVAL or as soon as a leak is detected.
+constexpr OsDeltaTime SUMMARY_INTERVAL = OsDeltaTime::from_sec(3600);
+// after more consecutive warm boots the node takes the cold path, with a sleep doubled at each reset
+constexpr uint8_t MAX_WARM_BOOTS = 3;
+constexpr int32_t REBOOT_BACKOFF_SEC = 30;
+// uptime after which the resets are no longer consecutive
+constexpr OsDeltaTime STABLE_UPTIME = OsDeltaTime::from_sec(3600);
+
+// With STATIONARY_NODE defined, ADR is enabled and readings are queued then sent
+// on port 22, as many as fit in the payload of the current data rate. The time between
+// uplinks follows the airtime so the duty rate (1 / 2^DUTY_RATE) is kept.
+constexpr uint8_t DUTY_RATE = 12;
 
 constexpr unsigned int BAUDRATE = 9600;
 
@@ -34,12 +63,42 @@ constexpr lmic_pinmap lmic_pins = {
     .dio = {9, 8},
 };
 
-RadioSx1276FSK radiofsk{lmic_pins, my_meter};
+AvrWmbusHal wmbusHal{lmic_pins};
+// WMBusMode::C1A or WMBusMode::C1B for meter in C1 mode
+RadioSx1276FSK radiofsk{wmbusHal, my_meter, WMBusMode::T1};
+#ifdef WMBUS_CHANNEL_HOPPING
+// each listen window rotates between the channels, a meter is received on any of them
+constexpr WmbusChannel wmbusChannels[] = {
+    wmbusChannel(wmbusFrequency(WMBusMode::T1), WMBusMode::T1),
+    wmbusChannel(wmbusFrequency(WMBusMode::C1A), WMBusMode::C1A),
+};
+#endif
+#ifdef RX_CALIBRATION
+// listen windows with each candidate RX profile, all the frames of a window are counted
+constexpr uint8_t RX_CALIBRATION_ROUNDS = 5;
+constexpr OsDeltaTime RX_CALIBRATION_WINDOW = OsDeltaTime::from_sec(60);
+RxCalibration rxCalibration;
+#endif
 RadioSx1276 radio{lmic_pins};
 LmicEu868 LMIC{radio};
 
 OsTime nextSend;
 
+PowerGovernor governor;
+
+// last reading, pending until it is sent
+std::array<uint8_t, 7> pendingReading;
+bool readingPending = false;
+OsTime nextVccSample;
+
+Consumption consumption;
+ReadingQueue readingQueue;
+OsTime nextUplink;
+OsTime lastReading;
+OsTime nextSummary;
+OsTime bootTime;
+uint8_t warmBoots = 0;
+
 
 class EEPROMStoring : public StoringAbtract {
 public:
@@ -61,6 +120,22 @@ private:
   size_t offset = 0;
 };
 
+// Saved at points where LMIC and the node state are consistent, never from
+// the watchdog interrupt: the loop may have hung in the middle of an update.
+void save_lmic_state() {
+  EEPROMStoring store;
+  store.store(&EEPROMVKEY, sizeof(EEPROMVKEY));
+  LMIC.saveStateWithoutTimeData(store);
+}
+
+void save_resume() {
+  const OsTime now = os_getTime();
+  const uint8_t boots = now - bootTime > STABLE_UPTIME ? 0 : warmBoots;
+  const uint16_t ageSec = std::min<int32_t>((now - lastReading).to_ms() / 1000, 0xFFFF);
+  const ResumeState state = {(nextSend - now).to_ms(), pendingReading, readingPending, ageSec, boots};
+  saveResumeState(wmbusHal, state);
+}
+
 void onEvent(EventType ev) {
   rst_wdt();
   switch (ev) {
@@ -70,16 +145,18 @@ void onEvent(EventType ev) {
     break;
   case EventType::JOINED: {
       PRINT_DEBUG(2, F("EV_JOINED"));
+#ifdef STATIONARY_NODE
+      // the node does not move, let the network adapt the data rate.
+      LMIC.setLinkCheckMode(true);
+#else
       // disable ADR because it will be mobile.
       LMIC.setLinkCheckMode(false);
+#endif
       // LMIC.setDrTx(0);
-      LMIC.setDutyRate(12);
+      LMIC.setDutyRate(DUTY_RATE);
 
-      EEPROMStoring store;
-      store.store(&EEPROMVKEY, sizeof(EEPROMVKEY));
       PRINT_DEBUG(1, F("Save state after join"));
-
-      LMIC.saveStateWithoutTimeData(store);
+      save_lmic_state();
       }
     break;
   case EventType::JOIN_FAILED:
@@ -90,12 +167,17 @@ void onEvent(EventType ev) {
       if (LMIC.getTxRxFlags().test(TxRxStatus::ACK)) {
         PRINT_DEBUG(1, F("Received ack"));
       }
-      if(LMIC.getSeqnoUp() % 0x40 == 0){
-        PRINT_DEBUG(1, F("Saving state after %d frames sent"), LMIC.getSeqnoUp());
-        EEPROMStoring store;
-        store.store(&EEPROMVKEY, sizeof(EEPROMVKEY));
-        LMIC.saveStateWithoutTimeData(store);
-      } 
+      // the readings of the uplink are sent, the next ones wait for nextUplink
+      readingQueue.txComplete();
+      if (readingQueue.size() == 0) {
+        readingPending = false;
+      }
+      // LMIC is idle, its state is consistent: keep the frame counter and
+      // the resume state for a reset (only the changed bytes are written)
+      if (LMIC.getSeqnoUp() % SEQNO_SAVE_INTERVAL == 0) {
+        save_lmic_state();
+      }
+      save_resume();
     }
     break;
   case EventType::RESET:
@@ -128,42 +210,174 @@ uint16_t read_vcc() {
   return (1100UL * 1023 / ADC);
 }
 
-void do_send_empty() {
+// Time before next listen window, longer with low battery
+OsDeltaTime tx_interval() { return OsDeltaTime::from_ms(TX_INTERVAL.to_ms() * governor.policy().txIntervalFactor); }
 
-  // battery
-  uint32_t bat_value = read_vcc();
-  PRINT_DEBUG(1, F("Batterie value %i"), bat_value);
-  uint8_t val = bat_value * 255 / 3000;
+// Battery level from the smoothed VCC, also given to LMIC
+uint8_t battery_level() {
+  PRINT_DEBUG(1, F("Batterie value %i"), governor.vcc());
+  uint8_t val = governor.level();
 
   if (LMIC.getTxRxFlags().test(TxRxStatus::NEED_BATTERY_LEVEL)) {
     LMIC.setBatteryLevel(val);
   }
+  return val;
+}
+
+// Data rate of the next uplink from LMIC: ADR and the payload sizes depend on it,
+// a LMICPP without the getter must not build with a guessed data rate.
+template <typename L, typename = void> struct has_dr_tx : std::false_type {};
+template <typename L>
+struct has_dr_tx<L, decltype(static_cast<void>(std::declval<L &>().getDrTx()))> : std::true_type {};
+static_assert(has_dr_tx<decltype(LMIC)>::value, "LMICPP-Arduino with Lmic::getDrTx() required");
+
+// Data rate of the next uplink, set by the network with ADR
+uint8_t current_dr() { return static_cast<uint8_t>(LMIC.getDrTx()); }
+
+void do_send_empty() {
+  if (!governor.policy().emptyUplink) {
+    PRINT_DEBUG(1, F("Low battery, no empty uplink"));
+    nextSend = os_getTime() + tx_interval();
+    return;
+  }
+
+  // battery
+  uint8_t val = battery_level();
+
+#ifdef ENABLE_PROFILING
+  // cycle counts since the last empty uplink instead of the battery level
+  printProfiling();
+  uint8_t profile[PROFILE_RECORD_SIZE * static_cast<uint8_t>(ProfilePoint::Count)];
+  const uint8_t size = packProfiling(profile, std::min<uint16_t>(maxPayloadSize(current_dr()), sizeof(profile)));
+  if (size > 0) {
+    profilingReset();
+    LMIC.setTxData2(23, profile, size, false);
+    PRINT_DEBUG(1, F("Profiling queued"));
+    nextSend = os_getTime() + tx_interval();
+    return;
+  }
+#endif
 
   // Prepare upstream data transmission at the next possible time.
   LMIC.setTxData2(3, &val, 1, false);
   PRINT_DEBUG(1, F("Packet queued"));
-  nextSend = os_getTime() + TX_INTERVAL;
+  nextSend = os_getTime() + tx_interval();
 }
 
 void do_send_counter(std::array<uint8_t, 7> &frame) {
-
-  // battery
-  uint32_t bat_value = read_vcc();
-  PRINT_DEBUG(1, F("Batterie value %i"), bat_value);
-  uint8_t val = bat_value * 255 / 3000;
-
-  if (LMIC.getTxRxFlags().test(TxRxStatus::NEED_BATTERY_LEVEL)) {
-    LMIC.setBatteryLevel(val);
-  }
+  battery_level();
 
   // Prepare upstream data transmission at the next possible time.
   LMIC.setTxData2(20, frame.begin(), frame.size(), false);
   PRINT_DEBUG(1, F("Packet queued"));
-  nextSend = os_getTime() + TX_INTERVAL;
+  nextSend = os_getTime() + tx_interval();
+}
+
+void do_send_summary() {
+  uint8_t summary[CONSUMPTION_SUMMARY_SIZE];
+  consumption.summary(summary);
+
+  LMIC.setTxData2(21, summary, sizeof(summary), false);
+  PRINT_DEBUG(1, F("Summary queued"));
+  nextSummary = os_getTime() + SUMMARY_INTERVAL;
+}
+
+// LMIC holds an uplink not yet sent, a new one would replace it
+bool tx_pending() { return LMIC.getOpMode().test(OpState::TXDATA) || LMIC.getOpMode().test(OpState::TXRXPEND); }
+
+// Only when nextUplink is reached and no uplink is pending,
+// the readings are removed from the queue on EV_TXCOMPLETE
+void do_send_readings() {
+  const uint8_t dr = current_dr();
+  uint8_t payload[READING_QUEUE_SIZE * READING_RECORD_SIZE];
+  const uint8_t maxSize = std::min<uint16_t>(maxPayloadSize(dr), sizeof(payload));
+  const uint8_t packed = readingQueue.pack(payload, maxSize, os_getTime());
+  const uint8_t size = packed * READING_RECORD_SIZE;
+
+  LMIC.setTxData2(22, payload, size, false);
+  readingQueue.setSent(packed);
+  PRINT_DEBUG(1, F("%d readings queued"), packed);
+  nextUplink = os_getTime() + std::max(tx_interval(), OsDeltaTime::from_ms(uplinkAirtime(dr, size).to_ms() << DUTY_RATE));
+}
+
+// age: time since the reading was received, when it is resumed after a reset
+void add_reading(std::array<uint8_t, 7> &frame, OsDeltaTime age = OsDeltaTime{}) {
+  const OsTime now = os_getTime();
+  const OsTime readAt = now - age;
+  consumption.addReading(rlsbf4(frame.begin() + 3), (readAt - lastReading).to_ms() / 1000);
+  lastReading = readAt;
+  pendingReading = frame;
+  readingPending = true;
+
+#ifdef SEND_CONSUMPTION_SUMMARY
+  if (consumption.newLeak() || nextSummary < now) {
+    do_send_summary();
+  }
+  nextSend = now + tx_interval();
+#elif defined(STATIONARY_NODE)
+  readingQueue.push(frame, readAt);
+  if (nextUplink < now && !tx_pending()) {
+    do_send_readings();
+  }
+  nextSend = now + tx_interval();
+#else
+  do_send_counter(frame);
+#endif
+  // a watchdog or brown-out reset gives no time to save
+  save_resume();
+}
+
+// Frame received while calibrating: the window stays open to count the next ones
+bool rx_calibration_frame() {
+#ifdef RX_CALIBRATION
+  if (!rxCalibration.running()) {
+    return false;
+  }
+  rxCalibration.frameReceived(radiofsk.last_rssi());
+  return true;
+#else
+  return false;
+#endif
+}
+
+// End of a listen window, go to the next RX profile while calibrating.
+// Return true if the window was a calibration window.
+bool rx_calibration_window() {
+#ifdef RX_CALIBRATION
+  if (!rxCalibration.running()) {
+    return false;
+  }
+  rxCalibration.windowDone();
+  if (rxCalibration.running()) {
+    radiofsk.set_rx_profile(rxCalibration.profile());
+    return true;
+  }
+  RxProfile best;
+  RxCalibrationStats stats;
+  if (rxCalibration.best(best, stats)) {
+    PRINT_DEBUG(1, F("RX profile bw %x lna %x preamble %x saved"), best.rxBw, best.lna, best.preambleDetect);
+    saveRxProfile(wmbusHal, best, stats);
+  } else {
+    PRINT_DEBUG(1, F("RX calibration: meter not received"));
+    best = DEFAULT_RX_PROFILE;
+  }
+  radiofsk.set_rx_profile(best);
+  return true;
+#else
+  return false;
+#endif
 }
 
-bool inWMBusMode = false;
-OsTime timeoutWMBus;
+OsDeltaTime listen_duration() {
+#ifdef RX_CALIBRATION
+  if (rxCalibration.running()) {
+    return RX_CALIBRATION_WINDOW;
+  }
+#endif
+  return OsDeltaTime::from_sec(governor.policy().listenSec);
+}
+
+RadioScheduler scheduler;
 
 // lmic_pins.dio[0]  = 9 => PCINT1
 // lmic_pins.dio[1]  = 8 => PCINT0
@@ -188,7 +402,7 @@ void testDuration(int32_t ms) {
   PRINT_DEBUG(1, F("Test sleep time for %i ms."), ms);
   const OsTime start = os_getTime();
   PRINT_DEBUG(1, F("Start Test sleep time."));
-  powersave(delta, []() { return false; });
+  wmbusHal.sleep(delta);
   const OsTime end = os_getTime();
   PRINT_DEBUG(1, F("End Test sleep time."));
   PRINT_DEBUG(1, F("Test Time should be : %d ms"), (end - start).to_ms());
@@ -208,6 +422,10 @@ void setup() {
 
   pciSetup(lmic_pins.dio[0]);
   pciSetup(lmic_pins.dio[1]);
+  profilingBegin();
+#ifdef WMBUS_CHANNEL_HOPPING
+  radiofsk.set_channels(wmbusChannels, sizeof(wmbusChannels) / sizeof(wmbusChannels[0]));
+#endif
 
   SPI.begin();
   // LMIC init
@@ -228,11 +446,65 @@ void setup() {
   if (vkey == EEPROMVKEY) {
     PRINT_DEBUG(1, F("Restoring state from EEPROM"));
     LMIC.loadStateWithoutTimeData(store);
+    // up to SEQNO_SAVE_INTERVAL - 1 uplinks were sent after the save, a counter
+    // already used would be rejected by the network
+    LMIC.setSeqnoUp(LMIC.getSeqnoUp() + SEQNO_SAVE_INTERVAL);
+    save_lmic_state();
   }
 
+#ifdef RX_CALIBRATION
+  rxCalibration.start(RX_CALIBRATION_ROUNDS);
+  radiofsk.set_rx_profile(rxCalibration.profile());
+#else
+  RxProfile rxProfile;
+  RxCalibrationStats rxStats;
+  if (loadRxProfile(wmbusHal, rxProfile, rxStats)) {
+    PRINT_DEBUG(1, F("RX profile bw %x lna %x preamble %x: %u frames in %u windows, rssi -%u dBm"), rxProfile.rxBw,
+                rxProfile.lna, rxProfile.preambleDetect, rxStats.frames, rxStats.windows, rxStats.meanRssi / 2);
+    radiofsk.set_rx_profile(rxProfile);
+  }
+#endif
+
+  governor.addSample(read_vcc());
+
+  // after a crash, resume where we were if the session is restored
+  const ResetCause cause = reset_cause();
+  ResumeState resume;
+  const bool resumed = loadResumeState(wmbusHal, resume) && vkey == EEPROMVKEY &&
+                       (cause == ResetCause::Watchdog || cause == ResetCause::BrownOut);
+  bootTime = os_getTime();
+  if (resumed) {
+    warmBoots = resume.warmBoots < 0xFF ? resume.warmBoots + 1 : 0xFF;
+  }
+  // a hang that comes back each time must not loop on the same uplink
+  const bool warmBoot = resumed && warmBoots <= MAX_WARM_BOOTS;
+
   // Only work with special boot loader.
   configure_wdt();
 
+  nextSummary = os_getTime() + SUMMARY_INTERVAL;
+  if (warmBoot) {
+    PRINT_DEBUG(1, F("Warm boot %u, resume"), warmBoots);
+    if (resume.readingPending) {
+      add_reading(resume.pendingReading, OsDeltaTime::from_sec(resume.pendingAgeSec));
+    }
+    // keep the phase with the meter
+    const int32_t nextListenMs = std::min<int32_t>(std::max<int32_t>(resume.nextListenMs, 0), tx_interval().to_ms());
+    nextSend = os_getTime() + OsDeltaTime::from_ms(nextListenMs);
+    // the count must survive a reset before the next reading
+    save_resume();
+    return;
+  }
+
+  if (warmBoots > MAX_WARM_BOOTS) {
+    // keep the count across the next reset, the pending reading is dropped
+    nextSend = os_getTime();
+    save_resume();
+    const uint8_t shift = std::min(warmBoots - MAX_WARM_BOOTS - 1, 6);
+    PRINT_DEBUG(1, F("%u warm boots, back off"), warmBoots);
+    wmbusHal.sleep(OsDeltaTime::from_sec(REBOOT_BACKOFF_SEC << shift));
+  }
+
   // test duration and in case of reboot loop  prevent flood
   // testDuration(1000);
   // testDuration(8000);
@@ -240,47 +512,104 @@ void setup() {
 
   // Start job (sending automatically starts OTAA too)
   nextSend = os_getTime();
-  inWMBusMode = true;
-  timeoutWMBus = os_getTime() + OsDeltaTime::from_sec(90);
+#ifdef RX_CALIBRATION
+  // the first window is not longer for the first candidate
+  scheduler.openListen(RX_CALIBRATION_WINDOW);
+#else
+  scheduler.openListen(OsDeltaTime::from_sec(90));
+#endif
 }
 
 void loop() {
   rst_wdt();
 
-  if (inWMBusMode) {
+  switch (scheduler.next(os_getTime())) {
+  case RadioTask::Listen: {
     std::array<uint8_t, 7> frame;
     auto state = radiofsk.listen_wmbus(frame);
     if (state == Listenstate::Complete) {
       radiofsk.stop_listen();
-      inWMBusMode = false;
+      if (!rx_calibration_frame()) {
+        scheduler.closeListen();
+      }
 
-      do_send_counter(frame);
-    } else if (os_getTime() > timeoutWMBus) {
+      add_reading(frame);
+    } else if (state == Listenstate::Duplicate) {
+      // meter is received but nothing new to send
+      logEvent(EventId::Duplicate);
+      radiofsk.stop_listen();
+      if (!rx_calibration_frame()) {
+        scheduler.closeListen();
+        nextSend = os_getTime() + tx_interval();
+      }
+    } else if (scheduler.listenExpired(os_getTime())) {
+      radiofsk.stop_listen();
+      scheduler.closeListen();
+      if (rx_calibration_window()) {
+        // next window right away, no empty uplink, the log would not hold a second window
+        if (governor.policy().debugOutput) {
+          printEventLog();
+        }
+        nextSend = os_getTime();
+        break;
+      }
       // we did not get any wmbus data
       PRINT_DEBUG(1, F("WMBUS timeout"));
-      radiofsk.stop_listen();
-      inWMBusMode = false;
-      
+
+#ifdef STATIONARY_NODE
+      if (nextUplink < os_getTime() && !tx_pending()) {
+        if (readingQueue.size() > 0) {
+          do_send_readings();
+        } else {
+          do_send_empty();
+        }
+      }
+      nextSend = os_getTime() + tx_interval();
+#else
       do_send_empty();
-    } 
-  } else {
+#endif
+    } else {
+      // CPU idle until a DIO line rises, the dwell on a channel is checked at least this often
+      wmbusHal.wait_dio(OsDeltaTime::from_ms(5));
+    }
+  } break;
+
+  case RadioTask::Preempt:
+    // give the radio back to LMIC, listening resume after its job
+    radiofsk.stop_listen();
+    break;
+
+  case RadioTask::Lmic: {
     OsDeltaTime freeTimeBeforeNextCall = LMIC.run();
+    const bool txRxPending = LMIC.getOpMode().test(OpState::TXRXPEND);
+    scheduler.lmicRun(os_getTime(), freeTimeBeforeNextCall, txRxPending);
 
     if (freeTimeBeforeNextCall > OsDeltaTime::from_ms(10)) {
       // we have more than 10 ms to do some work.
-      // the test must be adapted from the time spend in other task
-      if (nextSend < os_getTime() && !LMIC.getOpMode().test(OpState::TXRXPEND) &&
-          freeTimeBeforeNextCall > OsDeltaTime::from_sec(95)) {
+      if (scheduler.listenOpen()) {
+        // listening resume as soon as LMIC let enough time
+        if (!scheduler.listenReady(os_getTime())) {
+          wmbusHal.sleep(freeTimeBeforeNextCall);
+        }
+      } else if (nextSend < os_getTime() && !txRxPending) {
         PRINT_DEBUG(1, F("WMBUS start listenning"));
-
-        inWMBusMode = true;
-        timeoutWMBus = os_getTime() + OsDeltaTime::from_sec(40);
+        scheduler.openListen(listen_duration());
       } else {
         OsDeltaTime freeTimeBeforeSend = nextSend - os_getTime();
+        // radio is sleeping, good time to measure the battery
+        if (nextVccSample < os_getTime()) {
+          governor.addSample(read_vcc());
+          nextVccSample = os_getTime() + VCC_SAMPLE_INTERVAL;
+        }
+        // print debug events while nothing else is running
+        if (governor.policy().debugOutput) {
+          printEventLog();
+        }
         OsDeltaTime to_wait = std::min(freeTimeBeforeNextCall, freeTimeBeforeSend);
         // Go to sleep if we have nothing to do.
-        powersave(to_wait, []() { return false; });
+        wmbusHal.sleep(to_wait);
       }
     }
+  } break;
   }
-}
\ No newline at end of file
+}
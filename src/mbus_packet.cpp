@@ -3,6 +3,7 @@
 #include "3outof6.h"
 #include "crc.h"
 #include "mbus_packet.h"
+#include "profiling.h"
 
 /// @brief Returns the number of bytes in a Wireless MBUS packet from the
 /// L-field. Note that the L-field excludes the L-field and the CRC fields
@@ -14,7 +15,7 @@ uint16_t packetSize(uint8_t lField) {
   // Less than 26 (15 + 10)
   uint8_t nrBlocks = 2;
 
-  if (lField > 26)
+  if (lField >= 26)
     nrBlocks += 1 + ((lField - 26) / 16);
 
   // Add all extra fields, excluding the CRC fields
@@ -32,6 +33,7 @@ uint16_t packetSize(uint8_t lField) {
 /// @param packetSize Total Size of the Wireless MBUS packet (decoded size)
 /// @return Error code
 PacketDecodeResult decodeRXBytesTmode(const uint8_t *pByte, uint8_t *pPacket, uint16_t packetSize) {
+  PROFILE_SCOPE(DecodeTmode);
 
   uint16_t bytesRemaining = packetSize;
   uint16_t bytesEncoded = 0;
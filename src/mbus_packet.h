@@ -3,13 +3,86 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "3outof6.h"
+#include "crc.h"
+
 enum class PacketDecodeResult : uint8_t {
   OK = 0,
   CODING_ERROR = 1,
   CRC_ERROR = 2,
 };
 
+enum class WMBusMode : uint8_t {
+  // 3 out of 6 coding, frame format A
+  T1 = 0,
+  // NRZ coding, frame format A
+  C1A,
+  // NRZ coding, frame format B
+  C1B,
+};
+
 uint16_t packetSize(uint8_t lField);
 PacketDecodeResult decodeRXBytesTmode(const uint8_t *pByte, uint8_t *pPacket, uint16_t packetSize);
 
-#endif
\ No newline at end of file
+/// @brief Decode a TMODE packet with a fixed layout into a Wireless MBUS packet.
+/// Checks for 3 out of 6 decoding errors and CRC errors.
+/// @tparam Layout Frame layout (see frame_layout.h)
+/// @param pByte Pointer to TMBUS packet of Layout::encodedSize bytes
+/// @param pPacket Pointer to Wireless MBUS packet of Layout::size bytes
+/// @return Error code
+template <typename Layout> PacketDecodeResult decodeRXBytesTmode(const uint8_t *pByte, uint8_t *pPacket) {
+  // Blocks boundaries are on even bytes, so each block is decoded 2 bytes at a time
+  static_assert(Layout::firstBlockLength % 2 == 0 && Layout::blockLength % 2 == 0, "blocks must be 2 bytes aligned");
+
+  for (uint8_t block = 0; block < Layout::nbBlocks; block++) {
+    const uint16_t start = Layout::blockOffset(block);
+    const uint16_t crcStart = start + Layout::blockDataLength(block);
+    CrcCalc crc = {};
+    const uint8_t *encoded = pByte + start / 2 * 3;
+    uint8_t *data = pPacket + start;
+    for (uint8_t pairs = Layout::blockDataLength(block) / 2; pairs > 0; pairs--) {
+      if (!decode3outof6(encoded, data, false))
+        return PacketDecodeResult::CODING_ERROR;
+      crc.pushData(data[0]);
+      crc.pushData(data[1]);
+      encoded += 3;
+      data += 2;
+    }
+    // CRC field, after the last data byte if the block has an odd length
+    if (Layout::blockDataLength(block) % 2) {
+      if (!decode3outof6(encoded, data, false))
+        return PacketDecodeResult::CODING_ERROR;
+      crc.pushData(data[0]);
+      // only the last block can end on odd byte
+      if (!decode3outof6(encoded + 3, data + 2, crcStart + 2 == Layout::size))
+        return PacketDecodeResult::CODING_ERROR;
+    } else if (!decode3outof6(encoded, data, false)) {
+      return PacketDecodeResult::CODING_ERROR;
+    }
+    if (!(crc.checkHigh(pPacket[crcStart]) && crc.checkLow(pPacket[crcStart + 1])))
+      return PacketDecodeResult::CRC_ERROR;
+  }
+
+  return PacketDecodeResult::OK;
+}
+
+/// @brief Check a CMODE packet with a fixed layout (NRZ coding, frame format A or B).
+/// Checks for CRC errors.
+/// @tparam Layout Frame layout (see frame_layout.h)
+/// @param pPacket Pointer to Wireless MBUS packet of Layout::size bytes
+/// @return Error code
+template <typename Layout> PacketDecodeResult checkRXBytesCmode(const uint8_t *pPacket) {
+  for (uint8_t block = 0; block < Layout::nbBlocks; block++) {
+    const uint8_t *data = pPacket + Layout::blockOffset(block);
+    CrcCalc crc = {};
+    for (uint8_t i = 0; i < Layout::blockDataLength(block); i++) {
+      crc.pushData(data[i]);
+    }
+    data += Layout::blockDataLength(block);
+    if (!(crc.checkHigh(data[0]) && crc.checkLow(data[1])))
+      return PacketDecodeResult::CRC_ERROR;
+  }
+  return PacketDecodeResult::OK;
+}
+
+#endif
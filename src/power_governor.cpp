@@ -0,0 +1,70 @@
+#include "power_governor.h"
+
+namespace {
+// Each new sample count for 1 / 2^EMA_SHIFT of the smoothed value
+constexpr uint8_t EMA_SHIFT = 3;
+
+// Thresholds in mV to go down to a state and to go back up from it
+constexpr uint16_t LOW_ENTER = POWER_LOW_MV;
+constexpr uint16_t LOW_EXIT = POWER_LOW_MV + POWER_HYSTERESIS_MV;
+constexpr uint16_t CRITICAL_ENTER = POWER_CRITICAL_MV;
+constexpr uint16_t CRITICAL_EXIT = POWER_CRITICAL_MV + POWER_HYSTERESIS_MV;
+static_assert(CRITICAL_EXIT <= LOW_ENTER, "critical state must be left below the low threshold");
+static_assert(POWER_FULL_MV > POWER_LOW_MV, "full charge must be above the low threshold");
+
+// DevStatus battery: 0 is external power and 255 not measured
+constexpr uint8_t LEVEL_MIN = 1;
+constexpr uint8_t LEVEL_MAX = 254;
+
+// indexed by PowerState
+constexpr PowerPolicy policies[] = {
+    {1, 40, true, true},
+    {2, 20, false, false},
+    {6, 10, false, false},
+};
+} // namespace
+
+void PowerGovernor::addSample(uint16_t vccMv) {
+  // keep the value with its fraction in 16 bits
+  const uint16_t sample = (vccMv > 4095 ? 4095 : vccMv) << FRACTION_BITS;
+  if (filtered == 0) {
+    filtered = sample;
+  } else {
+    filtered += (static_cast<int32_t>(sample) - filtered) >> EMA_SHIFT;
+  }
+
+  const uint16_t mv = vcc();
+  switch (current) {
+  case PowerState::Normal:
+    if (mv < LOW_ENTER) {
+      current = PowerState::Low;
+    }
+    break;
+  case PowerState::Low:
+    if (mv < CRITICAL_ENTER) {
+      current = PowerState::Critical;
+    } else if (mv >= LOW_EXIT) {
+      current = PowerState::Normal;
+    }
+    break;
+  case PowerState::Critical:
+    if (mv >= CRITICAL_EXIT) {
+      current = PowerState::Low;
+    }
+    break;
+  }
+}
+
+const PowerPolicy &PowerGovernor::policy() const { return policies[static_cast<uint8_t>(current)]; }
+
+uint8_t PowerGovernor::level() const {
+  const uint16_t mv = vcc();
+  if (mv <= POWER_CRITICAL_MV) {
+    return LEVEL_MIN;
+  }
+  if (mv >= POWER_FULL_MV) {
+    return LEVEL_MAX;
+  }
+  return LEVEL_MIN + static_cast<uint32_t>(mv - POWER_CRITICAL_MV) * (LEVEL_MAX - LEVEL_MIN) /
+                         (POWER_FULL_MV - POWER_CRITICAL_MV);
+}
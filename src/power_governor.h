@@ -0,0 +1,60 @@
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include <stdint.h>
+
+// Thresholds in mV to enter the Low and Critical states, the state is left
+// POWER_HYSTERESIS_MV above. The defaults follow 2 NiMH AA cells without
+// regulator: about 2.4 V for most of the discharge, the knee below 1.1 V per cell.
+#ifndef POWER_LOW_MV
+#define POWER_LOW_MV 2250
+#endif
+#ifndef POWER_CRITICAL_MV
+#define POWER_CRITICAL_MV 2100
+#endif
+#ifndef POWER_HYSTERESIS_MV
+#define POWER_HYSTERESIS_MV 100
+#endif
+// VCC of the charged cells, top of the battery level
+#ifndef POWER_FULL_MV
+#define POWER_FULL_MV 2800
+#endif
+
+// Battery state from the smoothed VCC, with hysteresis between states.
+enum class PowerState : uint8_t {
+  Normal = 0,
+  Low,
+  Critical,
+};
+
+// What the node is allowed to do in a power state
+struct PowerPolicy {
+  // TX_INTERVAL is multiplied by this value
+  uint8_t txIntervalFactor;
+  // length of a wmbus listen window
+  uint8_t listenSec;
+  // print the debug events
+  bool debugOutput;
+  // send an uplink when no reading was received
+  bool emptyUplink;
+};
+
+class PowerGovernor final {
+public:
+  // Add a VCC measure in mV, should be done when the radio is idle
+  void addSample(uint16_t vccMv);
+  // Smoothed VCC in mV
+  uint16_t vcc() const { return filtered >> FRACTION_BITS; }
+  PowerState state() const { return current; }
+  // Battery level for the LoRaWAN DevStatus, 1 at POWER_CRITICAL_MV to 254 at POWER_FULL_MV
+  uint8_t level() const;
+  const PowerPolicy &policy() const;
+
+private:
+  static constexpr uint8_t FRACTION_BITS = 4;
+  // VCC in mV with FRACTION_BITS of fraction
+  uint16_t filtered = 0;
+  PowerState current = PowerState::Normal;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "profiling.h"
+
+#if defined(ENABLE_PROFILING) && defined(__AVR__)
+
+#include <hal/print_debug.h>
+#include <string.h>
+
+volatile uint16_t profileOverflows = 0;
+
+ISR(TIMER1_OVF_vect) { profileOverflows++; }
+
+namespace {
+
+struct PointStats {
+  uint16_t count;
+  uint32_t total;
+  uint32_t max;
+  uint16_t buckets[PROFILE_BUCKETS];
+};
+
+PointStats stats[static_cast<uint8_t>(ProfilePoint::Count)];
+// cycles of profileCycles() itself
+uint8_t overhead = 0;
+
+uint8_t bucket(uint32_t cycles) {
+  uint8_t index = 0;
+  for (cycles >>= 6; cycles != 0 && index < PROFILE_BUCKETS - 1; cycles >>= 1) {
+    index++;
+  }
+  return index;
+}
+
+void write3(uint8_t *buffer, uint32_t value) {
+  if (value > 0xFFFFFF) {
+    value = 0xFFFFFF;
+  }
+  buffer[0] = value;
+  buffer[1] = value >> 8;
+  buffer[2] = value >> 16;
+}
+
+#if LMIC_DEBUG_LEVEL > 0
+#define PRINT_POINT(name, stats)                                                                                     \
+  PRINT_DEBUG(1, F(name ": %u calls, mean %lu, max %lu"), (stats).count, (stats).total / (stats).count, (stats).max)
+
+void printPoint(uint8_t point, const PointStats &point_stats) {
+  switch (static_cast<ProfilePoint>(point)) {
+  case ProfilePoint::DecodeTmode:
+    PRINT_POINT("decodeRXBytesTmode", point_stats);
+    break;
+  case ProfilePoint::Decode3outof6:
+    PRINT_POINT("decode3outof6", point_stats);
+    break;
+  case ProfilePoint::CrcPushData:
+    PRINT_POINT("CrcCalc::pushData", point_stats);
+    break;
+  case ProfilePoint::DiehlLfsr:
+    PRINT_POINT("decodeDiehlLfsr", point_stats);
+    break;
+  case ProfilePoint::RadioInit:
+    PRINT_POINT("RadioSx1276FSK::init", point_stats);
+    break;
+  default:
+    PRINT_POINT("FIFO read", point_stats);
+    break;
+  }
+}
+#endif
+
+} // namespace
+
+void profileRecord(ProfilePoint point, uint32_t cycles) {
+  PointStats &point_stats = stats[static_cast<uint8_t>(point)];
+  cycles = cycles > overhead ? cycles - overhead : 0;
+  // the mean is of the first 0xFFFF records once the count saturates
+  if (point_stats.count < 0xFFFF) {
+    point_stats.count++;
+    point_stats.total += cycles;
+  }
+  point_stats.max = cycles > point_stats.max ? cycles : point_stats.max;
+  uint16_t &bucket_count = point_stats.buckets[bucket(cycles)];
+  if (bucket_count < 0xFFFF) {
+    bucket_count++;
+  }
+}
+
+void profilingBegin() {
+  // normal mode, clock without prescaler, overflow interrupt
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TCNT1 = 0;
+  TIFR1 = _BV(TOV1);
+  TIMSK1 = _BV(TOIE1);
+
+  const uint32_t start = profileCycles();
+  overhead = profileCycles() - start;
+  profilingReset();
+}
+
+void profilingReset() { memset(stats, 0, sizeof(stats)); }
+
+void printProfiling() {
+#if LMIC_DEBUG_LEVEL > 0
+  PRINT_DEBUG(1, F("Profiling (cycles at %lu Hz, histogram from < 64 by power of 2)"),
+              static_cast<unsigned long>(F_CPU));
+  for (uint8_t point = 0; point < static_cast<uint8_t>(ProfilePoint::Count); point++) {
+    const PointStats &point_stats = stats[point];
+    if (point_stats.count == 0) {
+      continue;
+    }
+    printPoint(point, point_stats);
+    const uint16_t *b = point_stats.buckets;
+    PRINT_DEBUG(1, F("  %u %u %u %u %u %u %u %u %u %u %u %u"), b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], b[8],
+                b[9], b[10], b[11]);
+  }
+#endif
+}
+
+uint8_t packProfiling(uint8_t *buffer, uint8_t size) {
+  uint8_t length = 0;
+  for (uint8_t point = 0; point < static_cast<uint8_t>(ProfilePoint::Count); point++) {
+    const PointStats &point_stats = stats[point];
+    if (point_stats.count == 0) {
+      continue;
+    }
+    if (length + PROFILE_RECORD_SIZE > size) {
+      break;
+    }
+    uint8_t *record = buffer + length;
+    record[0] = point;
+    record[1] = point_stats.count;
+    record[2] = point_stats.count >> 8;
+    write3(record + 3, point_stats.total / point_stats.count);
+    write3(record + 6, point_stats.max);
+    length += PROFILE_RECORD_SIZE;
+  }
+  return length;
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <stdint.h>
+
+// Cycle counts of the hot functions on the node, with ENABLE_PROFILING.
+// Timer1 runs free at F_CPU (no prescaler) and its overflows are counted,
+// PROFILE_SCOPE(point) records the cycles until the end of the scope in a
+// log2 histogram of the point. The time to read the counter is subtracted,
+// the recording of nested scopes is not (decode3outof6 and CrcCalc::pushData
+// inside decodeRXBytesTmode). Timer1 is stopped during power down sleep,
+// scopes must not contain a sleep.
+// Without ENABLE_PROFILING and on the host all functions are empty.
+
+enum class ProfilePoint : uint8_t {
+  DecodeTmode = 0,
+  Decode3outof6,
+  CrcPushData,
+  DiehlLfsr,
+  RadioInit,
+  FifoRead,
+  Count,
+};
+
+// Bucket 0: less than 64 cycles, bucket b: [2^(b+5), 2^(b+6)), last bucket: 2^16 and more
+constexpr uint8_t PROFILE_BUCKETS = 12;
+
+// Uplink record of a point (packProfiling):
+//  |  0 |     1-2     |      3-5      |     6-8     |
+//  | id | count (lsb) | mean (cycles) | max (cycles) |
+constexpr uint8_t PROFILE_RECORD_SIZE = 9;
+
+#if defined(ENABLE_PROFILING) && defined(__AVR__)
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+// Timer1 overflows, high 16 bits of the cycle counter
+extern volatile uint16_t profileOverflows;
+
+inline uint32_t profileCycles() {
+  const uint8_t sreg = SREG;
+  cli();
+  const uint16_t low = TCNT1;
+  uint16_t high = profileOverflows;
+  // overflow not yet handled by the interrupt
+  if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+    high++;
+  }
+  SREG = sreg;
+  return static_cast<uint32_t>(high) << 16 | low;
+}
+
+void profileRecord(ProfilePoint point, uint32_t cycles);
+
+class ProfileScope final {
+public:
+  explicit ProfileScope(ProfilePoint point) : point(point), start(profileCycles()) {}
+  ~ProfileScope() { profileRecord(point, profileCycles() - start); }
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  const ProfilePoint point;
+  const uint32_t start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(point) const ProfileScope PROFILE_CONCAT(profileScope, __LINE__){ProfilePoint::point}
+
+// Start Timer1 and measure the time to read it
+void profilingBegin();
+void profilingReset();
+// Print the count, mean, max and histogram of each point (LMIC_DEBUG_LEVEL > 0)
+void printProfiling();
+// Records of the points called at least once, as many as fit in size bytes, return the length
+uint8_t packProfiling(uint8_t *buffer, uint8_t size);
+
+#else
+
+#define PROFILE_SCOPE(point) \
+  do {                       \
+  } while (0)
+
+inline void profilingBegin() {}
+inline void profilingReset() {}
+inline void printProfiling() {}
+inline uint8_t packProfiling(uint8_t *, uint8_t) { return 0; }
+
+#endif
+
+#endif
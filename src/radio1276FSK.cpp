@@ -7,12 +7,11 @@
 #include <lmic/radio_sx1276.h>
 #include <stdio.h>
 
+#include "capture.h"
+#include "eventlog.h"
 #include "izar.h"
 #include "mbus_packet.h"
-#include "powersave.h"
-
-RadioSx1276FSK::RadioSx1276FSK(lmic_pinmap const &pins, const std::array<uint8_t, 6> &meter_id)
-    : meter_id(meter_id), hal(pins) {}
+#include "profiling.h"
 
 namespace {
 constexpr uint8_t RegFifo = 0x00;   // common
@@ -31,6 +30,7 @@ constexpr uint8_t RegOcp = 0x0B;      // common
 constexpr uint8_t RegLna = 0x0C;      // common
 constexpr uint8_t RegRxConfig = 0x0D;
 constexpr uint8_t RegRssiConfig = 0x0E;
+constexpr uint8_t RegRssiValue = 0x11;
 constexpr uint8_t RegRxBw = 0x12;
 constexpr uint8_t RegAfcBw = 0x13;
 constexpr uint8_t RegAfcFei = 0x1A;
@@ -76,94 +76,97 @@ constexpr uint8_t IrqPayloadReady = 0x04;
 constexpr uint8_t IrqCrcOk = 0x02;
 constexpr uint8_t IrqRssi = 0x01;
 
+constexpr uint8_t IrqPllLock = 0x10;
 constexpr uint8_t IrqPreambleDetect = 0x02;
+constexpr uint8_t IrqSyncAddressMatch = 0x01;
+
+// RegRxConfig of FSK_INIT_CMD with RestartRxWithPllLock
+constexpr uint8_t RxConfigRestartWithPllLock = 0x1E | 0x20;
+// PLL lock takes less than 100 us, a SPI read at least 20 us
+constexpr uint8_t PLL_LOCK_POLLS = 20;
+
+// Time on a channel without any preamble, several times the preamble and sync word of a frame
+constexpr OsDeltaTime CHANNEL_DWELL = OsDeltaTime::from_ms(40);
+// Extension once a preamble is detected, renewed while the sync word is matched,
+// longer than a T1 frame (45 bytes at 100 kchip/s = 3.6 ms)
+constexpr OsDeltaTime FRAME_DWELL = OsDeltaTime::from_ms(15);
 
 const uint32_t xtal_freq = 32000000;
 
 // Param
-constexpr uint32_t t1_freq = 868950000;
-constexpr uint64_t const frf = ((uint64_t)t1_freq << 19) / xtal_freq;
-
 constexpr uint32_t t1_deviation = 50000;
 constexpr uint16_t fdev = ((uint64_t)t1_deviation << 19) / xtal_freq;
 
+constexpr uint32_t c1_deviation = 45000;
+constexpr uint16_t fdevC1 = ((uint64_t)c1_deviation << 19) / xtal_freq;
+
 constexpr uint32_t t1_datarate = 100000;
 constexpr uint32_t dt = xtal_freq / t1_datarate;
 
 constexpr uint32_t preambleLen = 3;
 constexpr uint32_t syncWord = 0x5555543DULL;
-constexpr uint8_t fifoThreshold = 15;
-
+// C mode sync word, last byte select the frame format
+constexpr uint32_t syncWordC1A = 0x543D54CDULL;
+constexpr uint32_t syncWordC1B = 0x543D543DULL;
+// FifoLevel interrupt is raised when the FIFO (64 bytes) contains more than
+// fifoThreshold bytes, each interrupt read fifoThreshold bytes in one SPI transaction (T1).
+// Higher value means less SPI transactions but less margin before FIFO overrun.
+#ifndef WMBUS_FIFO_THRESHOLD
+#define WMBUS_FIFO_THRESHOLD 32
+#endif
+constexpr uint8_t fifoThreshold = WMBUS_FIFO_THRESHOLD;
+static_assert(fifoThreshold > 0 && fifoThreshold < 64, "FIFO threshold must be lower than FIFO size");
+// RSSI is read at the first FifoLevel interrupt, it must come before the end of the frame
+static_assert(fifoThreshold < IzarLayout::encodedSize, "FIFO threshold must be lower than the T1 frame");
+// C1 frames (28 or 30 bytes) are shorter than fifoThreshold, half of them
+// raise FifoLevel while the frame is received
+constexpr uint8_t fifoThresholdC1 = IzarLayoutB::size / 2;
+
+// Sorted by register address, consecutive registers are written in one burst.
+// RegFrf is not in the tables: init() writes the frequency of the channel, by
+// default the one of the mode (T1 868.95 MHz, C1 869.525 MHz).
 CONST_TABLE(uint16_t, FSK_INIT_CMD)
 [] = {
-    RegSet(RegLna, 0x23).raw(),
+    // datarate
+    RegSet(RegBitrateMsb, (uint8_t)(dt >> 8)).raw(),
+    RegSet(RegBitrateLsb, (uint8_t)(dt >> 0)).raw(),
+
+    // RegLna from the RX profile
     // RestartRxWithPLLClock, AfcAutoOn, AGC
     // auto on, PreambleDetect, AGC & AFC
     RegSet(RegRxConfig, 0x1E).raw(),
     // RSSI Offset, RSSI smoothing using 8 samples
     RegSet(RegRssiConfig, 0xD2).raw(),
+
+    // RegRxBw and RegAfcBw from the RX profile
+
     // AfcAutoClearOn
     RegSet(RegAfcFei, 0x01).raw(),
-    // PreambleDetectorOn, PreambleDetectorSize = 3 bytes, 4
-    // chip errros per bit tolerated
-    RegSet(RegPreambleDetect, 0xAA).raw(),
+    // RegPreambleDetect from the RX profile
     // ClkOut OFF
     RegSet(RegOsc, 0x07).raw(),
-    // AutoRestartRxMod = wait for PLL to lock, PreamblePolarity =
-    // 0x55, Sync on, Size of the Sync Word = SyncSize + 1 = 2
-    // RegSet(RegSyncConfig, 0xb3).raw(),
-
-    // Sync Word
-    // RegSet(RegSyncValue1, (uint8_t)(syncWord >> 24)).raw(),
-    // RegSet(RegSyncValue2, (uint8_t)(syncWord >> 16)).raw(),
-    // RegSet(RegSyncValue3, (uint8_t)(syncWord >> 8)).raw(),
-    // RegSet(RegSyncValue4, (uint8_t)(syncWord >> 0)).raw(),
-
-    // limit to only 2 bytes of sync word
-    // AutoRestartRxMod = wait for PLL to lock, PreamblePolarity =
-    // 0x55, Sync on, Size of the Sync Word = SyncSize + 1
-    RegSet(RegSyncConfig, 0xb1).raw(),
-    RegSet(RegSyncValue1, (uint8_t)(syncWord >> 8)).raw(),
-    RegSet(RegSyncValue2, (uint8_t)(syncWord >> 0)).raw(),
-
-
-    RegSet(RegFifoThresh, fifoThreshold).raw(),
-    // Temperature change threshold = 10°C
-    RegSet(RegImageCal, 0x02).raw(),
-    // freq
-    RegSet(RegFrfMsb, (uint8_t)(frf >> 16)).raw(),
-    RegSet(RegFrfMid, (uint8_t)(frf >> 8)).raw(),
-    RegSet(RegFrfLsb, (uint8_t)(frf >> 0)).raw(),
-
-    // deviation
-    // FSTEP= 32,000,000 / 2^19 = 61.03515625 Hz
-    // FDEV = 50,000 / 61.03515625 = 819.2
-    RegSet(RegFdevMsb, (uint8_t)(fdev >> 8)).raw(),
-    RegSet(RegFdevLsb, (uint8_t)(fdev >> 0)).raw(),
-
-    // datarate
-    RegSet(RegBitrateMsb, (uint8_t)(dt >> 8)).raw(),
-    RegSet(RegBitrateLsb, (uint8_t)(dt >> 0)).raw(),
-
-    // bandwidth 2*t1_deviation + t1_datarate
-    // 2*50_000 + 100_000 = 200_000
-    // => register value 0x09
-    RegSet(RegRxBw, 0x09).raw(),
-    RegSet(RegAfcBw, 0x09).raw(),
 
     // preamble (not sure)
     RegSet(RegPreambleMsb, (uint8_t)((preambleLen >> 8) & 0xFF)).raw(),
     RegSet(RegPreambleLsb, (uint8_t)(preambleLen & 0xFF)).raw(),
 
-    // payload length
-    // limited to only one type of frame
-    RegSet(RegPayloadLength, IZAR_LENGH_3OUTOF6).raw(),
     // config
     // addr filtering off, crc off, fixed length
     // packet mode
     RegSet(RegPacketConfig1, 0x00).raw(),
     RegSet(RegPacketConfig2, 0x40).raw(),
 
+    // RegFifoThresh from the mode
+    // sequencer off (reset value)
+    RegSet(RegSeqConfig1, 0x00).raw(),
+    // transition
+    // receive to low power
+    // From Standby to Rx
+    RegSet(RegSeqConfig2, 0x04).raw(),
+
+    // Temperature change threshold = 10°C
+    RegSet(RegImageCal, 0x02).raw(),
+
     // DIO mapping
     // DIO0=PayloadReady => Read Data
     // DIO1=FifoLevel    => Read Data
@@ -173,19 +176,98 @@ CONST_TABLE(uint16_t, FSK_INIT_CMD)
     // DIO5=ModeReady    => Not used
     RegSet(RegDioMapping1, 0b00000000).raw(),
     RegSet(RegDioMapping2, 0b11000001).raw(),
-
-    // transition
-    // receive to low power
-    // From Standby to Rx
-    RegSet(RegSeqConfig2, 0x04).raw(),
-}; // namespace
+};
 
 constexpr uint8_t NB_TX_INIT_CMD = sizeof(RESOLVE_TABLE(FSK_INIT_CMD)) / sizeof(RESOLVE_TABLE(FSK_INIT_CMD)[0]);
 
+// T1 mode, 3 out of 6 coding
+CONST_TABLE(uint16_t, FSK_T1_CMD)
+[] = {
+    // deviation
+    // FSTEP= 32,000,000 / 2^19 = 61.03515625 Hz
+    // FDEV = 50,000 / 61.03515625 = 819.2
+    RegSet(RegFdevMsb, (uint8_t)(fdev >> 8)).raw(),
+    RegSet(RegFdevLsb, (uint8_t)(fdev >> 0)).raw(),
+
+    // limit to only 2 bytes of sync word
+    // AutoRestartRxMod = wait for PLL to lock, PreamblePolarity =
+    // 0x55, Sync on, Size of the Sync Word = SyncSize + 1
+    RegSet(RegSyncConfig, 0xb1).raw(),
+    RegSet(RegSyncValue1, (uint8_t)(syncWord >> 8)).raw(),
+    RegSet(RegSyncValue2, (uint8_t)(syncWord >> 0)).raw(),
+
+    // payload length
+    // limited to only one type of frame
+    RegSet(RegPayloadLength, IzarLayout::encodedSize).raw(),
+    RegSet(RegFifoThresh, fifoThreshold).raw(),
+};
+
+constexpr uint8_t NB_T1_CMD = sizeof(RESOLVE_TABLE(FSK_T1_CMD)) / sizeof(RESOLVE_TABLE(FSK_T1_CMD)[0]);
+
+// C1 mode frame format A, NRZ coding
+CONST_TABLE(uint16_t, FSK_C1A_CMD)
+[] = {
+    // deviation 45 kHz
+    RegSet(RegFdevMsb, (uint8_t)(fdevC1 >> 8)).raw(),
+    RegSet(RegFdevLsb, (uint8_t)(fdevC1 >> 0)).raw(),
+
+    // AutoRestartRxMod = wait for PLL to lock, PreamblePolarity =
+    // 0x55, Sync on, Size of the Sync Word = SyncSize + 1 = 4
+    RegSet(RegSyncConfig, 0xb3).raw(),
+    RegSet(RegSyncValue1, (uint8_t)(syncWordC1A >> 24)).raw(),
+    RegSet(RegSyncValue2, (uint8_t)(syncWordC1A >> 16)).raw(),
+    RegSet(RegSyncValue3, (uint8_t)(syncWordC1A >> 8)).raw(),
+    RegSet(RegSyncValue4, (uint8_t)(syncWordC1A >> 0)).raw(),
+
+    // payload length, no encoding
+    RegSet(RegPayloadLength, IzarLayout::size).raw(),
+    RegSet(RegFifoThresh, fifoThresholdC1).raw(),
+};
+
+constexpr uint8_t NB_C1A_CMD = sizeof(RESOLVE_TABLE(FSK_C1A_CMD)) / sizeof(RESOLVE_TABLE(FSK_C1A_CMD)[0]);
+
+// C1 mode frame format B, NRZ coding
+CONST_TABLE(uint16_t, FSK_C1B_CMD)
+[] = {
+    // deviation 45 kHz
+    RegSet(RegFdevMsb, (uint8_t)(fdevC1 >> 8)).raw(),
+    RegSet(RegFdevLsb, (uint8_t)(fdevC1 >> 0)).raw(),
+
+    // AutoRestartRxMod = wait for PLL to lock, PreamblePolarity =
+    // 0x55, Sync on, Size of the Sync Word = SyncSize + 1 = 4
+    RegSet(RegSyncConfig, 0xb3).raw(),
+    RegSet(RegSyncValue1, (uint8_t)(syncWordC1B >> 24)).raw(),
+    RegSet(RegSyncValue2, (uint8_t)(syncWordC1B >> 16)).raw(),
+    RegSet(RegSyncValue3, (uint8_t)(syncWordC1B >> 8)).raw(),
+    RegSet(RegSyncValue4, (uint8_t)(syncWordC1B >> 0)).raw(),
+
+    // payload length, no encoding
+    RegSet(RegPayloadLength, IzarLayoutB::size).raw(),
+    RegSet(RegFifoThresh, fifoThresholdC1).raw(),
+};
+
+constexpr uint8_t NB_C1B_CMD = sizeof(RESOLVE_TABLE(FSK_C1B_CMD)) / sizeof(RESOLVE_TABLE(FSK_C1B_CMD)[0]);
+
 } // namespace
 
+RadioSx1276FSK::RadioSx1276FSK(WmbusHal &hal, const std::array<uint8_t, 6> &meter_id, WMBusMode mode,
+                               uint32_t meter_key)
+    : meter_id(meter_id), meter_key(meter_key), hal(hal), mode(mode),
+      single_channel(wmbusChannel(wmbusFrequency(mode), mode)),
+      channels(&single_channel) {}
+
+void RadioSx1276FSK::set_channels(const WmbusChannel *list, uint8_t nb) {
+  // the radio is configured again by the next listen_wmbus()
+  listening = false;
+  current_raw_byte = 0;
+  channels = list;
+  nb_channels = nb;
+  channel = 0;
+  mode = channels[0].mode;
+}
+
 void RadioSx1276FSK::init() {
-  PRINT_DEBUG(1, F("Config wmbus"));
+  PROFILE_SCOPE(RadioInit);
   if ((hal.read_reg(RegOpMode) & 0xF0) != 0) {
     // need to go to sleep state if not in FSK mode
     hal.write_reg(RegOpMode, OPMODE_FSK | OPMODE_SLEEP);
@@ -193,40 +275,177 @@ void RadioSx1276FSK::init() {
 
   hal.write_reg(RegOpMode, OPMODE_FSK | OPMODE_STANDBY);
 
-  for (uint8_t i = 0; i < NB_TX_INIT_CMD; i++) {
-    RegSet cmd{table_get_u2(RESOLVE_TABLE(FSK_INIT_CMD), i)};
-    hal.write_reg(cmd.reg, cmd.val);
+  write_cmds(RESOLVE_TABLE(FSK_INIT_CMD), NB_TX_INIT_CMD);
+  write_rx_profile();
+  write_mode_cmds();
+  write_frf();
+}
+
+void RadioSx1276FSK::set_rx_profile(const RxProfile &profile) {
+  // written by the next listen_wmbus()
+  listening = false;
+  current_raw_byte = 0;
+  rx_profile = profile;
+}
+
+void RadioSx1276FSK::write_rx_profile() {
+  hal.write_reg(RegLna, rx_profile.lna);
+  const uint8_t bandwidths[] = {rx_profile.rxBw, rx_profile.afcBw};
+  hal.write_buffer(RegRxBw, bandwidths, sizeof(bandwidths));
+  hal.write_reg(RegPreambleDetect, rx_profile.preambleDetect);
+}
+
+void RadioSx1276FSK::write_mode_cmds() {
+  switch (mode) {
+  case WMBusMode::T1:
+    write_cmds(RESOLVE_TABLE(FSK_T1_CMD), NB_T1_CMD);
+    break;
+  case WMBusMode::C1A:
+    write_cmds(RESOLVE_TABLE(FSK_C1A_CMD), NB_C1A_CMD);
+    break;
+  case WMBusMode::C1B:
+    write_cmds(RESOLVE_TABLE(FSK_C1B_CMD), NB_C1B_CMD);
+    break;
   }
+}
 
-  PRINT_DEBUG(1, F("Config done"));
+void RadioSx1276FSK::write_frf() {
+  const uint32_t frf = channels[channel].frf;
+  // the frequency changes when RegFrfLsb is written
+  const uint8_t regs[] = {static_cast<uint8_t>(frf >> 16), static_cast<uint8_t>(frf >> 8), static_cast<uint8_t>(frf)};
+  hal.write_buffer(RegFrfMsb, regs, sizeof(regs));
+}
+
+// Retune to the next channel without init(): only the Frf registers (and the
+// mode registers if the mode changes), then restart RX once the PLL is locked
+void RadioSx1276FSK::hop() {
+  channel = (channel + 1) % nb_channels;
+  const WMBusMode next_mode = channels[channel].mode;
+  if (next_mode != mode) {
+    hal.write_reg(RegOpMode, OPMODE_FSK | OPMODE_STANDBY);
+    mode = next_mode;
+    write_mode_cmds();
+    write_frf();
+    hal.write_reg(RegOpMode, OPMODE_FSK | OPMODE_RX);
+  } else {
+    write_frf();
+    hal.write_reg(RegRxConfig, RxConfigRestartWithPllLock);
+  }
+  for (uint8_t i = 0; i < PLL_LOCK_POLLS && !(hal.read_reg(RegIrqFlags1) & IrqPllLock); i++) {
+  }
+  dwell_start = hal.time();
+  dwell_extended = false;
+}
+
+void RadioSx1276FSK::write_cmds(const uint16_t *cmds, uint8_t nb) {
+  // consecutive registers are written in one SPI transaction (address auto increment)
+  uint8_t burst[8];
+  uint8_t burst_reg = 0;
+  uint8_t burst_len = 0;
+  for (uint8_t i = 0; i < nb; i++) {
+    RegSet cmd{table_get_u2(cmds, i)};
+    if (burst_len == sizeof(burst) || (burst_len > 0 && cmd.reg != burst_reg + burst_len)) {
+      hal.write_buffer(burst_reg, burst, burst_len);
+      burst_len = 0;
+    }
+    if (burst_len == 0) {
+      burst_reg = cmd.reg;
+    }
+    burst[burst_len++] = cmd.val;
+  }
+  if (burst_len > 0) {
+    hal.write_buffer(burst_reg, burst, burst_len);
+  }
+}
+
+uint8_t *RadioSx1276FSK::rx_data() {
+  // In C mode there is no encoding, FIFO is read directly in decoded buffer
+  return mode == WMBusMode::T1 ? buffer_raw.begin() : buffer.begin();
+}
+
+uint8_t RadioSx1276FSK::rx_length() const {
+  switch (mode) {
+  case WMBusMode::C1A:
+    return IzarLayout::size;
+  case WMBusMode::C1B:
+    return IzarLayoutB::size;
+  default:
+    return IzarLayout::encodedSize;
+  }
+}
+
+PacketDecodeResult RadioSx1276FSK::decode_frame() {
+  switch (mode) {
+  case WMBusMode::C1A:
+    return checkRXBytesCmode<IzarLayout>(buffer.begin());
+  case WMBusMode::C1B:
+    return checkRXBytesCmode<IzarLayoutB>(buffer.begin());
+  default:
+    return decodeRXBytesTmode<IzarLayout>(buffer_raw.begin(), buffer.begin());
+  }
+}
+
+bool RadioSx1276FSK::extract_frame(std::array<uint8_t, 7> &result) const {
+  if (mode == WMBusMode::C1B) {
+    return printAndExtractIZAR<IzarLayoutB>(buffer.begin(), IzarLayoutB::size, meter_id, result, meter_key);
+  }
+  return printAndExtractIZAR<IzarLayout>(buffer.begin(), IzarLayout::size, meter_id, result, meter_key);
+}
+
+// Last CRC field of the frame
+uint16_t RadioSx1276FSK::frame_crc() const {
+  const uint8_t size = mode == WMBusMode::C1B ? IzarLayoutB::size : IzarLayout::size;
+  return (buffer[size - 2] << 8) | buffer[size - 1];
 }
 
 void RadioSx1276FSK::handle_payload_ready() {
   // Read end of packet
-  uint8_t remaining = IZAR_LENGH_3OUTOF6 - current_raw_byte;
-  hal.read_buffer(RegFifo, buffer_raw.begin() + current_raw_byte, remaining);
+  uint8_t remaining = rx_length() - current_raw_byte;
+  {
+    PROFILE_SCOPE(FifoRead);
+    hal.read_buffer(RegFifo, rx_data() + current_raw_byte, remaining);
+  }
   current_raw_byte += remaining;
   hal.write_reg(RegOpMode, OPMODE_STANDBY);
 }
 
 void RadioSx1276FSK::handle_fifo_level() {
   // Read partial FIFO
-  uint8_t remaining = IZAR_LENGH_3OUTOF6 - current_raw_byte;
-  uint8_t to_read = std::min(remaining, (uint8_t)(fifoThreshold - 1));
-  hal.read_buffer(RegFifo, buffer_raw.begin() + current_raw_byte, to_read);
+  read_rssi();
+  uint8_t remaining = rx_length() - current_raw_byte;
+  uint8_t to_read = std::min(remaining, mode == WMBusMode::T1 ? fifoThreshold : fifoThresholdC1);
+  {
+    PROFILE_SCOPE(FifoRead);
+    hal.read_buffer(RegFifo, rx_data() + current_raw_byte, to_read);
+  }
   current_raw_byte += to_read;
 }
 
+void RadioSx1276FSK::read_rssi() {
+  // The first FifoLevel interrupt of a frame comes while it is received
+  // (the thresholds are lower than the frame lengths), PayloadReady after its end
+  if (current_raw_byte == 0) {
+    rssi = hal.read_reg(RegRssiValue);
+  }
+}
+
 Listenstate RadioSx1276FSK::listen_wmbus(std::array<uint8_t, 7> &result) {
   Listenstate state = Listenstate::waiting;
   if (!listening) {
-    PRINT_DEBUG(1, F("Start listen wmbus"));
+    logEvent(EventId::ListenStart);
+    if (!capture_origin_set) {
+      capture_origin = hal.time();
+      capture_origin_set = true;
+    }
+    mode = channels[channel].mode;
     init();
     current_raw_byte = 0;
 
     // start rx
     hal.write_reg(RegOpMode, (hal.read_reg(RegOpMode) & ~OPMODE_MASK) | OPMODE_RX);
     listening = true;
+    dwell_start = hal.time();
+    dwell_extended = false;
 
     #if LMIC_DEBUG_LEVEL > 1
     // print all config
@@ -245,58 +464,70 @@ Listenstate RadioSx1276FSK::listen_wmbus(std::array<uint8_t, 7> &result) {
     handle_payload_ready();
   }
 
+  // never leave a channel while a frame is read
+  if (nb_channels > 1 && current_raw_byte == 0 &&
+      hal.time() - dwell_start > (dwell_extended ? FRAME_DWELL : CHANNEL_DWELL)) {
+    // a frame is starting on this channel: extended once on a preamble,
+    // then again as long as its sync word is matched
+    const uint8_t starting = dwell_extended ? IrqSyncAddressMatch : IrqPreambleDetect | IrqSyncAddressMatch;
+    if (hal.read_reg(RegIrqFlags1) & starting) {
+      dwell_extended = true;
+      dwell_start = hal.time();
+    } else {
+      hop();
+    }
+  }
+
 #if LMIC_DEBUG_LEVEL > 0
-  if (os_getTime() - debugtime > OsDeltaTime::from_sec(5)) {
-    debugtime = os_getTime();
+  if (hal.time() - debugtime > OsDeltaTime::from_sec(5)) {
+    debugtime = hal.time();
     auto irq1 = hal.read_reg(RegIrqFlags1);
     auto irq2 = hal.read_reg(RegIrqFlags2);
-    PRINT_DEBUG(1, F("State %02x, IRQ1 %02x, IRQ2 %02x, current_raw_byte %d"), hal.read_reg(RegOpMode), irq1, irq2,
-                current_raw_byte);
+    const uint8_t radioState[] = {hal.read_reg(RegOpMode), irq1, irq2, current_raw_byte};
+    logEvent(EventId::RadioState, radioState, sizeof(radioState));
 
     if (irq2 & IrqFifoOverrun) {
       hal.write_reg(RegIrqFlags2, IrqFifoOverrun);
       hal.write_reg(RegOpMode, (hal.read_reg(RegOpMode) & ~OPMODE_MASK) | OPMODE_STANDBY);
-      PRINT_DEBUG(1, F("Fifo overrun"));
+      logEvent(EventId::FifoOverrun);
 
       hal.write_reg(RegOpMode, (hal.read_reg(RegOpMode) & ~OPMODE_MASK) | OPMODE_RX);
     }
 
     if (irq2 & IrqFifoFull) {
       hal.write_reg(RegOpMode, (hal.read_reg(RegOpMode) & ~OPMODE_MASK) | OPMODE_STANDBY);
-      PRINT_DEBUG(1, F("Fifo full"));
+      logEvent(EventId::FifoFull);
       hal.write_reg(RegOpMode, (hal.read_reg(RegOpMode) & ~OPMODE_MASK) | OPMODE_RX);
     }
 
     if (irq1 & IrqPreambleDetect) {
       hal.write_reg(RegIrqFlags1, IrqPreambleDetect);
-      PRINT_DEBUG(1, F("Preamble detect"));
+      logEvent(EventId::PreambleDetect);
     }
       
   }
 #endif
 
-  if (current_raw_byte == IZAR_LENGH_3OUTOF6) {
+  if (current_raw_byte == rx_length()) {
     
     state = Listenstate::InvalidFrame;
 
-    PRINT_DEBUG(1, F("Payload read"));
-    PRINT_DEBUG(1, F("Payload RAW: %02x %02x %02x %02x %02x %02x %02x %02x"), buffer_raw[0], buffer_raw[1],
-                buffer_raw[2], buffer_raw[3], buffer_raw[4], buffer_raw[5], buffer_raw[6], buffer_raw[7]);
-
-    auto decode_result = decodeRXBytesTmode(buffer_raw.begin(), buffer.begin(), IZAR_LENGH);
+#if LMIC_DEBUG_LEVEL > 0
+    uint8_t capture[CAPTURE_HEADER_SIZE];
+    CaptureHeader{static_cast<uint32_t>((hal.time() - capture_origin).to_ms()), rssi, mode, rx_length()}.write(
+        capture);
+    logEvent(EventId::Capture, capture, sizeof(capture), rx_data(), rx_length());
+#endif
 
-    PRINT_DEBUG(1, F("decode packet %d "), (int)decode_result);
-    PRINT_DEBUG(1, F("Payload: %02x %02x %02x %02x %02x %02x %02x %02x"), buffer[0], buffer[1], buffer[2], buffer[3],
-                buffer[4], buffer[5], buffer[6], buffer[7]);
-    PRINT_DEBUG(1, F("Payload: %02x %02x %02x %02x %02x %02x %02x %02x"), buffer[8], buffer[9], buffer[10], buffer[11],
-                buffer[12], buffer[13], buffer[14], buffer[15]);
+    auto decode_result = decode_frame();
+    logEvent(EventId::DecodeResult, reinterpret_cast<const uint8_t *>(&decode_result), sizeof(decode_result));
 
     if (decode_result == PacketDecodeResult::OK) {
-      if(printAndExtractIZAR(buffer.begin(), buffer.size(), meter_id, result)){
-        state = Listenstate::Complete;
+      if (extract_frame(result)) {
+        // A field after L, C and M fields
+        state = dedup.accept(buffer.begin() + 4, frame_crc(), result, hal.time()) ? Listenstate::Complete
+                                                                                    : Listenstate::Duplicate;
       }
-      if (LMIC_DEBUG_LEVEL > 0)
-        printf("\n");
     }
     current_raw_byte = 0;
     listening = false;
@@ -306,7 +537,7 @@ Listenstate RadioSx1276FSK::listen_wmbus(std::array<uint8_t, 7> &result) {
 }
 
 void RadioSx1276FSK::stop_listen() {
-  PRINT_DEBUG(1, F("Stopping listen WMBUS"));
+  logEvent(EventId::ListenStop);
   current_raw_byte = 0;
   listening = false;
   hal.write_reg(RegOpMode, OPMODE_SLEEP);
@@ -1,44 +1,108 @@
 #ifndef radio1276FSK_h
 #define radio1276FSK_h
 
-#include "hal/hal_io.h"
 #include <array>
 #include <stdint.h>
 
-constexpr uint8_t IZAR_LENGH_3OUTOF6 = 0x45;
-constexpr uint8_t IZAR_LENGH = 30;
+#include "dedup.h"
+#include "frame_layout.h"
+#include "izar.h"
+#include "mbus_packet.h"
+#include "rx_profile.h"
+#include "wmbus_hal.h"
 
 enum class Listenstate : uint8_t {
 
   waiting = 0,
   InvalidFrame,
   Complete,
+  // same telegram or reading than the last one forwarded
+  Duplicate,
 };
 
+// EN 13757-4 meter to other frequencies
+constexpr uint32_t T1_FREQUENCY = 868950000;
+constexpr uint32_t C1_FREQUENCY = 869525000;
+
+// Frequency of the meters of a mode, C1 frame format A and B share it
+constexpr uint32_t wmbusFrequency(WMBusMode mode) { return mode == WMBusMode::T1 ? T1_FREQUENCY : C1_FREQUENCY; }
+
+// A frequency and the mode of the frames listened on it
+struct WmbusChannel {
+  // RegFrf value: frequency / (32 MHz / 2^19)
+  uint32_t frf;
+  WMBusMode mode;
+};
+
+constexpr WmbusChannel wmbusChannel(uint32_t frequency, WMBusMode mode) {
+  return {static_cast<uint32_t>((static_cast<uint64_t>(frequency) << 19) / 32000000), mode};
+}
+
 class RadioSx1276FSK final {
 public:
-  explicit RadioSx1276FSK(lmic_pinmap const &pins,
-                          const std::array<uint8_t, 6> &meter_id);
+  // Listen on the frequency of the mode (wmbusFrequency)
+  explicit RadioSx1276FSK(WmbusHal &hal, const std::array<uint8_t, 6> &meter_id, WMBusMode mode = WMBusMode::T1,
+                          uint32_t meter_key = DIEHL_DEFAULT_KEY);
+  // channels may point to single_channel
+  RadioSx1276FSK(const RadioSx1276FSK &) = delete;
+  RadioSx1276FSK &operator=(const RadioSx1276FSK &) = delete;
+  // Listen on the channels in turn (the array is not copied), staying on a channel
+  // while a frame is detected. A window starts on the channel where the last one stopped.
+  void set_channels(const WmbusChannel *list, uint8_t nb);
+  // Bandwidth, LNA and preamble detector used from the next listen
+  void set_rx_profile(const RxProfile &profile);
   Listenstate listen_wmbus(std::array<uint8_t, 7> &result);
   void stop_listen();
-  bool io_check() const {
-    return hal.io_check();
-  }
+  // Mode of the current channel (of the last frame)
+  WMBusMode current_mode() const { return mode; }
+  // Last frame received as read from the FIFO ("3 out of 6" encoded in T1 mode), for capture
+  const uint8_t *last_raw() const { return mode == WMBusMode::T1 ? buffer_raw.begin() : buffer.begin(); }
+  uint8_t rx_length() const;
+  // RegRssiValue while the last frame was received (first FifoLevel interrupt)
+  uint8_t last_rssi() const { return rssi; }
 
 private:
   void init();
+  void write_rx_profile();
+  void write_mode_cmds();
+  void write_frf();
+  void hop();
   void handle_payload_ready();
   void handle_fifo_level();
+  void read_rssi();
+  void write_cmds(const uint16_t *cmds, uint8_t nb);
+  uint8_t *rx_data();
+  PacketDecodeResult decode_frame();
+  bool extract_frame(std::array<uint8_t, 7> &result) const;
+  uint16_t frame_crc() const;
 
 
   const std::array<uint8_t, 6> &meter_id;
-  HalIo hal;
+  // LFSR key of the meter
+  const uint32_t meter_key;
+  WmbusHal &hal;
+  WMBusMode mode;
+  RxProfile rx_profile = DEFAULT_RX_PROFILE;
+  WmbusChannel single_channel;
+  const WmbusChannel *channels;
+  uint8_t nb_channels = 1;
+  uint8_t channel = 0;
+  // start of the time on the current channel, or of its last extension
+  OsTime dwell_start;
+  bool dwell_extended = false;
   bool listening = false;
-  std::array<uint8_t, IZAR_LENGH_3OUTOF6> buffer_raw = {0};
+  std::array<uint8_t, IzarLayout::encodedSize> buffer_raw = {0};
   uint8_t current_raw_byte = 0;
-  std::array<uint8_t, IZAR_LENGH> buffer = {0};
+  std::array<uint8_t, IzarLayout::size> buffer = {0};
+  static_assert(IzarLayoutB::size <= IzarLayout::size, "C1 frame format B is read in buffer");
 
   OsTime debugtime;
+  // RegRssiValue while the last frame was received
+  uint8_t rssi = 0;
+  // time reference of the captured frames
+  OsTime capture_origin;
+  bool capture_origin_set = false;
+  DedupCache dedup;
 };
 
 #endif
\ No newline at end of file
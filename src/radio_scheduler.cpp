@@ -0,0 +1,57 @@
+#include "radio_scheduler.h"
+
+namespace {
+// stop listening this time before a LMIC job
+constexpr OsDeltaTime LMIC_GUARD = OsDeltaTime::from_ms(100);
+// do not (re)start listening for less than this time
+constexpr OsDeltaTime MIN_LISTEN_SLICE = OsDeltaTime::from_sec(2);
+} // namespace
+
+void RadioScheduler::lmicRun(OsTime now, OsDeltaTime freeTime, bool txRxPending) {
+  lmicDeadline = now + freeTime;
+  lmicTxRxPending = txRxPending;
+}
+
+RadioTask RadioScheduler::next(OsTime now) {
+  if (running) {
+    if (lmicDeadline - now > LMIC_GUARD) {
+      return RadioTask::Listen;
+    }
+    remaining = remainingListen(now);
+    running = false;
+    return RadioTask::Preempt;
+  }
+
+  if (listenReady(now)) {
+    running = true;
+    runningSince = now;
+    return RadioTask::Listen;
+  }
+  return RadioTask::Lmic;
+}
+
+void RadioScheduler::openListen(OsDeltaTime duration) {
+  open = true;
+  running = false;
+  remaining = duration;
+}
+
+void RadioScheduler::closeListen() {
+  open = false;
+  running = false;
+}
+
+OsDeltaTime RadioScheduler::remainingListen(OsTime now) const {
+  if (!running) {
+    return remaining;
+  }
+  return remaining - (now - runningSince);
+}
+
+bool RadioScheduler::listenExpired(OsTime now) const {
+  return !(remainingListen(now) > OsDeltaTime::from_ms(0));
+}
+
+bool RadioScheduler::listenReady(OsTime now) const {
+  return open && !running && !lmicTxRxPending && lmicDeadline - now > MIN_LISTEN_SLICE;
+}
@@ -0,0 +1,46 @@
+#ifndef radio_scheduler_h
+#define radio_scheduler_h
+
+#include <lmic/oslmic.h>
+#include <stdint.h>
+
+enum class RadioTask : uint8_t {
+  // call LMIC.run() then lmicRun()
+  Lmic = 0,
+  // call listen_wmbus()
+  Listen,
+  // a LMIC job is near, stop listening, it will resume after
+  Preempt,
+};
+
+// Share the SX1276 between LMIC jobs and wmbus listen windows.
+// A listen window is a budget of listen time, the listening is
+// suspended before each LMIC job (TX, RX windows, join) and resumed
+// when LMIC gives enough free time.
+class RadioScheduler final {
+public:
+  // Result of LMIC.run()
+  void lmicRun(OsTime now, OsDeltaTime freeTime, bool txRxPending);
+  RadioTask next(OsTime now);
+
+  // Start a new window of duration listen time
+  void openListen(OsDeltaTime duration);
+  void closeListen();
+  bool listenOpen() const { return open; }
+  bool listenExpired(OsTime now) const;
+  // A suspended window can resume now
+  bool listenReady(OsTime now) const;
+
+private:
+  OsDeltaTime remainingListen(OsTime now) const;
+
+  OsTime lmicDeadline;
+  bool lmicTxRxPending = false;
+  bool open = false;
+  bool running = false;
+  // listen time left when listening has been started or suspended
+  OsDeltaTime remaining;
+  OsTime runningSince;
+};
+
+#endif
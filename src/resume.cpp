@@ -0,0 +1,100 @@
+#include "resume.h"
+
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+constexpr uint8_t RESUME_KEY = 0xA5;
+// the state is saved after each reading, each save goes to the next slot
+constexpr uint8_t RESUME_SLOTS = 8;
+
+struct StoredResumeState {
+  uint8_t key;
+  // incremented at each save, the valid slot with the last one is loaded
+  uint8_t sequence;
+  ResumeState state;
+  uint8_t checksum;
+};
+
+// at the end of the store
+uint16_t slotAddress(const WmbusHal &hal, uint8_t slot) {
+  return hal.store_size() - (RESUME_SLOTS - slot) * sizeof(StoredResumeState);
+}
+
+// over the bytes written, padding included (zeroed on save)
+uint8_t checksum(const StoredResumeState &stored) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&stored);
+  uint8_t sum = RESUME_KEY;
+  for (uint8_t i = 0; i < offsetof(StoredResumeState, checksum); i++) {
+    sum = (sum << 1 | sum >> 7) ^ bytes[i];
+  }
+  return sum;
+}
+
+bool valid(const StoredResumeState &stored) { return stored.key == RESUME_KEY && stored.checksum == checksum(stored); }
+
+// sequence a saved after sequence b, they are less than RESUME_SLOTS apart
+bool after(uint8_t a, uint8_t b) { return static_cast<int8_t>(a - b) > 0; }
+
+// Slot of the last valid save, RESUME_SLOTS if there is none
+uint8_t lastSlot(WmbusHal &hal, StoredResumeState &last) {
+  uint8_t found = RESUME_SLOTS;
+  for (uint8_t slot = 0; slot < RESUME_SLOTS; slot++) {
+    StoredResumeState stored;
+    hal.retrieve(slotAddress(hal, slot), &stored, sizeof(stored));
+    if (valid(stored) && (found == RESUME_SLOTS || after(stored.sequence, last.sequence))) {
+      found = slot;
+      last = stored;
+    }
+  }
+  return found;
+}
+
+// Slot written last when all of them are invalidated: the sequences still
+// follow each other up to it
+uint8_t lastWrittenSlot(WmbusHal &hal, uint8_t &sequence) {
+  uint8_t sequences[RESUME_SLOTS];
+  for (uint8_t slot = 0; slot < RESUME_SLOTS; slot++) {
+    hal.retrieve(slotAddress(hal, slot) + offsetof(StoredResumeState, sequence), &sequences[slot], 1);
+  }
+  uint8_t slot = 0;
+  while (slot < RESUME_SLOTS - 1 && sequences[slot + 1] == static_cast<uint8_t>(sequences[slot] + 1)) {
+    slot++;
+  }
+  sequence = sequences[slot];
+  return slot;
+}
+} // namespace
+
+void saveResumeState(WmbusHal &hal, const ResumeState &state) {
+  StoredResumeState last;
+  uint8_t slot = lastSlot(hal, last);
+  uint8_t sequence = last.sequence;
+  if (slot == RESUME_SLOTS) {
+    slot = lastWrittenSlot(hal, sequence);
+  }
+
+  StoredResumeState stored;
+  memset(&stored, 0, sizeof(stored));
+  stored.key = RESUME_KEY;
+  stored.sequence = sequence + 1;
+  stored.state = state;
+  stored.checksum = checksum(stored);
+  hal.store(slotAddress(hal, (slot + 1) % RESUME_SLOTS), &stored, sizeof(stored));
+}
+
+uint16_t resumeStoreSize() { return RESUME_SLOTS * sizeof(StoredResumeState); }
+
+bool loadResumeState(WmbusHal &hal, ResumeState &state) {
+  StoredResumeState last;
+  if (lastSlot(hal, last) == RESUME_SLOTS) {
+    return false;
+  }
+  // used only once, the older saves too
+  const uint8_t invalid = 0;
+  for (uint8_t slot = 0; slot < RESUME_SLOTS; slot++) {
+    hal.store(slotAddress(hal, slot), &invalid, sizeof(invalid));
+  }
+  state = last.state;
+  return true;
+}
@@ -0,0 +1,34 @@
+#ifndef RESUME_H
+#define RESUME_H
+
+#include <array>
+#include <stdint.h>
+
+#include "wmbus_hal.h"
+
+// State needed to resume after a watchdog or brown-out reset without
+// losing the phase of the meter or the last reading.
+// Stored at the end of the persistent store, the LMIC state is at the start.
+// It is saved after each reading: the saves rotate over several slots so that
+// each EEPROM cell is written only once every few readings.
+struct ResumeState {
+  // time before the next listen window when saved (ms)
+  int32_t nextListenMs;
+  // last reading not yet sent, the other readings queued by a stationary node
+  // are not kept: the slots would be too large for the EEPROM
+  std::array<uint8_t, 7> pendingReading;
+  bool readingPending;
+  // time since the last reading when saved (s, saturated)
+  uint16_t pendingAgeSec;
+  // consecutive warm boots, 0 once the node ran long enough without a reset
+  uint8_t warmBoots;
+};
+
+// Save the state, only at points where it is consistent (not from an interrupt)
+void saveResumeState(WmbusHal &hal, const ResumeState &state);
+// Load the state saved before the reset and invalidate it, return false if there is none
+bool loadResumeState(WmbusHal &hal, ResumeState &state);
+// Bytes used at the end of the persistent store
+uint16_t resumeStoreSize();
+
+#endif
@@ -0,0 +1,125 @@
+#include "rx_profile.h"
+
+#include <hal/print_debug.h>
+#include <stddef.h>
+
+#include "resume.h"
+
+namespace {
+constexpr uint8_t RX_PROFILE_KEY = 0x5A;
+
+// RxBw single side: 100, 125, 166.7 and 200 kHz. T1 needs at least
+// deviation + bit rate / 2 = 100 kHz, the AFC gets one step more for the
+// frequency error of the meter.
+constexpr uint8_t rxBws[] = {0x0A, 0x02, 0x11, 0x09};
+constexpr uint8_t afcBws[] = {0x02, 0x11, 0x09, 0x01};
+// G1 (AGC on), LNA boost off then on (150% LNA current)
+constexpr uint8_t lnas[] = {0x20, 0x23};
+// PreambleDetectorOn, size 1, 2 or 3 bytes, 10 chip errors tolerated
+constexpr uint8_t preambleDetects[] = {0x8A, 0xAA, 0xCA};
+
+constexpr uint8_t NB_LNA = sizeof(lnas) / sizeof(lnas[0]);
+constexpr uint8_t NB_PREAMBLE = sizeof(preambleDetects) / sizeof(preambleDetects[0]);
+constexpr uint8_t NB_CANDIDATES = sizeof(rxBws) / sizeof(rxBws[0]) * NB_LNA * NB_PREAMBLE;
+
+struct StoredRxProfile {
+  uint8_t key;
+  RxProfile profile;
+  RxCalibrationStats stats;
+  uint8_t checksum;
+};
+
+uint16_t rxProfileAddress(const WmbusHal &hal) {
+  return hal.store_size() - resumeStoreSize() - sizeof(StoredRxProfile);
+}
+
+uint8_t checksum(const StoredRxProfile &stored) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&stored);
+  uint8_t sum = RX_PROFILE_KEY;
+  for (uint8_t i = 0; i < offsetof(StoredRxProfile, checksum); i++) {
+    sum = (sum << 1 | sum >> 7) ^ bytes[i];
+  }
+  return sum;
+}
+} // namespace
+
+uint8_t RxCalibration::nbCandidates() { return NB_CANDIDATES; }
+
+RxProfile RxCalibration::candidateProfile(uint8_t index) {
+  if (index >= NB_CANDIDATES) {
+    return DEFAULT_RX_PROFILE;
+  }
+  const uint8_t bw = index / (NB_LNA * NB_PREAMBLE);
+  return {rxBws[bw], afcBws[bw], lnas[index / NB_PREAMBLE % NB_LNA], preambleDetects[index % NB_PREAMBLE]};
+}
+
+void RxCalibration::start(uint8_t nbRounds) {
+  rounds = nbRounds > 0 ? nbRounds : 1;
+  candidate = 0;
+  window = 0;
+  frames = 0;
+  rssiSum = 0;
+  bestCandidate = 0;
+  bestFrames = 0;
+  bestRssiSum = 0;
+}
+
+void RxCalibration::frameReceived(uint8_t rssi) {
+  if (!running()) {
+    return;
+  }
+  if (frames < 0xFFFF) {
+    frames++;
+    rssiSum += rssi;
+  }
+}
+
+void RxCalibration::windowDone() {
+  if (!running()) {
+    return;
+  }
+  if (++window < rounds) {
+    return;
+  }
+
+  const RxProfile tested = profile();
+  PRINT_DEBUG(1, F("RX profile %d bw %x lna %x preamble %x: %u frames in %d windows, rssi -%u dBm"), candidate,
+              tested.rxBw, tested.lna, tested.preambleDetect, frames, rounds,
+              frames > 0 ? static_cast<unsigned>(rssiSum / frames / 2) : 0);
+  // same number of frames: the lower sum is the lower mean, the stronger signal
+  if (frames > bestFrames || (frames == bestFrames && frames > 0 && rssiSum < bestRssiSum)) {
+    bestFrames = frames;
+    bestRssiSum = rssiSum;
+    bestCandidate = candidate;
+  }
+  candidate++;
+  window = 0;
+  frames = 0;
+  rssiSum = 0;
+}
+
+bool RxCalibration::best(RxProfile &profile, RxCalibrationStats &stats) const {
+  if (bestFrames == 0) {
+    return false;
+  }
+  profile = candidateProfile(bestCandidate);
+  stats = {bestFrames, rounds, static_cast<uint8_t>(bestRssiSum / bestFrames)};
+  return true;
+}
+
+void saveRxProfile(WmbusHal &hal, const RxProfile &profile, const RxCalibrationStats &stats) {
+  StoredRxProfile stored = {RX_PROFILE_KEY, profile, stats, 0};
+  stored.checksum = checksum(stored);
+  hal.store(rxProfileAddress(hal), &stored, sizeof(stored));
+}
+
+bool loadRxProfile(WmbusHal &hal, RxProfile &profile, RxCalibrationStats &stats) {
+  StoredRxProfile stored;
+  hal.retrieve(rxProfileAddress(hal), &stored, sizeof(stored));
+  if (stored.key != RX_PROFILE_KEY || stored.checksum != checksum(stored)) {
+    return false;
+  }
+  profile = stored.profile;
+  stats = stored.stats;
+  return true;
+}
@@ -0,0 +1,67 @@
+#ifndef RX_PROFILE_H
+#define RX_PROFILE_H
+
+#include <stdint.h>
+
+#include "wmbus_hal.h"
+
+// Receiver settings of the SX1276 (register values)
+struct RxProfile {
+  uint8_t rxBw;
+  uint8_t afcBw;
+  uint8_t lna;
+  uint8_t preambleDetect;
+};
+
+// 200 kHz, LNA boost, preamble detector on 2 bytes
+constexpr RxProfile DEFAULT_RX_PROFILE = {0x09, 0x09, 0x23, 0xAA};
+
+// Reception of the meter with a profile, kept with the chosen profile
+struct RxCalibrationStats {
+  // frames received in all the windows
+  uint16_t frames;
+  uint8_t windows;
+  // mean RSSI of the frames (-dBm * 2, lower is stronger)
+  uint8_t meanRssi;
+};
+
+// Sweep of the receiver settings, one candidate profile for rounds listen
+// windows of the same duration. Every frame of the window is counted, the
+// window is not closed by the first one. The best candidate receives the
+// most frames, on a tie the strongest mean RSSI (the best link margin),
+// then the first one: candidates are ordered from the lowest RX current and
+// narrowest bandwidth.
+class RxCalibration final {
+public:
+  void start(uint8_t rounds);
+  bool running() const { return candidate < nbCandidates(); }
+  // Profile to use for the next listen window
+  RxProfile profile() const { return candidateProfile(candidate); }
+  // Frame of the meter received in the current window
+  void frameReceived(uint8_t rssi);
+  // End of a listen window
+  void windowDone();
+  // Best profile once the sweep is done, false if the meter was never received
+  bool best(RxProfile &profile, RxCalibrationStats &stats) const;
+
+  static uint8_t nbCandidates();
+  static RxProfile candidateProfile(uint8_t index);
+
+private:
+  uint8_t rounds = 0;
+  uint8_t candidate = 0xFF;
+  uint8_t window = 0;
+  uint16_t frames = 0;
+  // sum of the RSSI of the received frames (-dBm * 2)
+  uint32_t rssiSum = 0;
+  uint8_t bestCandidate = 0;
+  uint16_t bestFrames = 0;
+  uint32_t bestRssiSum = 0;
+};
+
+// Profile and its stats at the end of the persistent store, before the resume state
+void saveRxProfile(WmbusHal &hal, const RxProfile &profile, const RxCalibrationStats &stats);
+// Return false if no valid profile is stored
+bool loadRxProfile(WmbusHal &hal, RxProfile &profile, RxCalibrationStats &stats);
+
+#endif
@@ -0,0 +1,68 @@
+#include "uplink_queue.h"
+
+#include <algorithm>
+#include <lmic/bufferpack.h>
+
+namespace {
+// MHDR (1) + FHDR without FOpts (7) + FPort (1) + MIC (4)
+constexpr uint8_t LORAWAN_OVERHEAD = 13;
+constexpr uint8_t PREAMBLE_SYMBOLS = 8;
+// coding rate 4/5
+constexpr uint8_t CODING_RATE = 1;
+} // namespace
+
+uint8_t maxPayloadSize(uint8_t dr) {
+  if (dr <= 2) {
+    return 51;
+  }
+  if (dr == 3) {
+    return 115;
+  }
+  return 222;
+}
+
+OsDeltaTime uplinkAirtime(uint8_t dr, uint8_t payloadSize) {
+  // DR0 to DR5: SF12 to SF7 at 125 kHz, DR6: SF7 at 250 kHz
+  const uint8_t sf = dr < 6 ? 12 - dr : 7;
+  const uint32_t symbolUs = (1UL << sf) * (dr < 6 ? 8 : 4);
+  // low data rate optimization at SF11 and SF12 on 125 kHz
+  const uint8_t lowDr = sf >= 11 && dr < 6 ? 1 : 0;
+
+  // explicit header and CRC on
+  const int16_t bits = 8 * (payloadSize + LORAWAN_OVERHEAD) - 4 * sf + 28 + 16;
+  const uint8_t bitsPerSymbol = 4 * (sf - 2 * lowDr);
+  const uint16_t payloadSymbols = 8 + (bits > 0 ? (bits + bitsPerSymbol - 1) / bitsPerSymbol : 0) * (CODING_RATE + 4);
+
+  // preamble is 4.25 symbols longer
+  const uint32_t us = symbolUs * (4 * (PREAMBLE_SYMBOLS + payloadSymbols) + 17) / 4;
+  return OsDeltaTime::from_us(us);
+}
+
+void ReadingQueue::push(const std::array<uint8_t, 7> &reading, OsTime time) {
+  if (count == entries.size()) {
+    pop(1);
+  }
+  entries[(first + count) % entries.size()] = {reading, time};
+  count++;
+}
+
+uint8_t ReadingQueue::pack(uint8_t *buffer, uint8_t maxPayload, OsTime now) const {
+  const uint8_t packed = std::min(count, capacity(maxPayload));
+  for (uint8_t i = 0; i < packed; i++) {
+    const Entry &entry = entries[(first + i) % entries.size()];
+    const int32_t age = (now - entry.time).to_ms() / 60000;
+    wlsbf2(buffer, std::min<int32_t>(age, 0xFFFF));
+    std::copy(entry.reading.begin(), entry.reading.end(), buffer + 2);
+    buffer += READING_RECORD_SIZE;
+  }
+  return packed;
+}
+
+void ReadingQueue::pop(uint8_t nb) {
+  nb = std::min(nb, count);
+  first = (first + nb) % entries.size();
+  count -= nb;
+  sent = sent > nb ? sent - nb : 0;
+}
+
+void ReadingQueue::txComplete() { pop(sent); }
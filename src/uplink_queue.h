@@ -0,0 +1,58 @@
+#ifndef UPLINK_QUEUE_H
+#define UPLINK_QUEUE_H
+
+#include <array>
+#include <lmic/oslmic.h>
+#include <stdint.h>
+
+// Readings waiting for an uplink (stationary node).
+// Readings are packed as many as fit in the maximum payload of the current
+// data rate, each record:
+//  |     0-1       |   2-4   |    5-8      |
+//  | age (minutes) |  flags  | index (lsb) |
+
+constexpr uint8_t READING_RECORD_SIZE = 9;
+#ifndef READING_QUEUE_SIZE
+#define READING_QUEUE_SIZE 16
+#endif
+
+// Maximum application payload at a data rate (EU868, without FOpts)
+uint8_t maxPayloadSize(uint8_t dr);
+// Time on air of an uplink with payloadSize bytes of application payload (EU868)
+OsDeltaTime uplinkAirtime(uint8_t dr, uint8_t payloadSize);
+
+// The readings of an uplink stay in the queue until LMIC reports it sent
+// (EV_TXCOMPLETE): pack() then setSent() when the frame is given to LMIC,
+// txComplete() when it is sent.
+class ReadingQueue final {
+public:
+  // Add a reading, the oldest one is dropped if the queue is full
+  // (it is still in the uplink if it was sent)
+  void push(const std::array<uint8_t, 7> &reading, OsTime time);
+  uint8_t size() const { return count; }
+  // Number of readings fitting in maxPayload
+  static uint8_t capacity(uint8_t maxPayload) { return maxPayload / READING_RECORD_SIZE; }
+  // Write the oldest readings fitting in maxPayload bytes, return the number of readings written.
+  // They stay in the queue until txComplete() or pop()
+  uint8_t pack(uint8_t *buffer, uint8_t maxPayload, OsTime now) const;
+  // Remove the count oldest readings, sent or not
+  void pop(uint8_t count);
+  // The count oldest readings are in the uplink given to LMIC
+  void setSent(uint8_t nb) { sent = nb < count ? nb : count; }
+  uint8_t inUplink() const { return sent; }
+  // The uplink is sent, remove its readings
+  void txComplete();
+
+private:
+  struct Entry {
+    std::array<uint8_t, 7> reading;
+    OsTime time;
+  };
+  std::array<Entry, READING_QUEUE_SIZE> entries;
+  uint8_t first = 0;
+  uint8_t count = 0;
+  // oldest readings in the uplink waiting in LMIC
+  uint8_t sent = 0;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef WMBUS_HAL_H
+#define WMBUS_HAL_H
+
+#include <lmic/oslmic.h>
+#include <stdint.h>
+
+// Hardware used by the wmbus receiver (SX1276 on SPI, DIO lines, clock,
+// sleep and persistent store). Implemented for the node in wmbus_hal_avr.h,
+// for a Linux board and as a fake radio for host tools in tools/.
+class WmbusHal {
+public:
+  virtual uint8_t read_reg(uint8_t addr) = 0;
+  virtual void write_reg(uint8_t addr, uint8_t data) = 0;
+  // addr is auto incremented, except for RegFifo
+  virtual void read_buffer(uint8_t addr, uint8_t *buf, uint8_t len) = 0;
+  virtual void write_buffer(uint8_t addr, const uint8_t *buf, uint8_t len) = 0;
+  // level of DIO0 (PayloadReady) and DIO1 (FifoLevel)
+  virtual bool io_check0() = 0;
+  virtual bool io_check1() = 0;
+  // wait at most timeout for DIO0 or DIO1 to be high, time() is updated,
+  // return false on timeout
+  virtual bool wait_dio(OsDeltaTime timeout) = 0;
+
+  virtual OsTime time() = 0;
+  // sleep at most duration, time() is updated
+  virtual void sleep(OsDeltaTime duration) = 0;
+
+  // persistent store of store_size() bytes
+  virtual uint16_t store_size() const = 0;
+  virtual void store(uint16_t address, const void *data, uint8_t size) = 0;
+  virtual void retrieve(uint16_t address, void *data, uint8_t size) = 0;
+
+protected:
+  ~WmbusHal() = default;
+};
+
+#endif
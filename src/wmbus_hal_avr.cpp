@@ -0,0 +1,48 @@
+#include "wmbus_hal_avr.h"
+
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <lmic.h>
+
+#include "powersave.h"
+
+AvrWmbusHal::AvrWmbusHal(lmic_pinmap const &pins) : io(pins) {}
+
+OsTime AvrWmbusHal::time() { return os_getTime(); }
+
+void AvrWmbusHal::sleep(OsDeltaTime duration) {
+  powersave(duration, []() { return false; });
+}
+
+bool AvrWmbusHal::wait_dio(OsDeltaTime timeout) {
+  // Idle sleep: the power down of powersave() only counts whole watchdog
+  // periods, a pin change waking it early would move the clock ahead, and
+  // the oscillator start-up delays the FIFO read. In idle the clock runs,
+  // the pin change or the timer interrupt wakes the CPU.
+  const OsTime end = time() + timeout;
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (!io_check0() && !io_check1() && end - time() > OsDeltaTime::from_ms(0)) {
+    // the lines are checked again with the interrupts off: a change after the
+    // check is pending and wakes the CPU, sei() takes effect after sleep_cpu()
+    cli();
+    if (!io_check0() && !io_check1()) {
+      sleep_enable();
+      sei();
+      sleep_cpu();
+      sleep_disable();
+    }
+    sei();
+  }
+  return io_check0() || io_check1();
+}
+
+uint16_t AvrWmbusHal::store_size() const { return E2END + 1; }
+
+void AvrWmbusHal::store(uint16_t address, const void *data, uint8_t size) {
+  eeprom_update_block(data, reinterpret_cast<void *>(address), size);
+}
+
+void AvrWmbusHal::retrieve(uint16_t address, void *data, uint8_t size) {
+  eeprom_read_block(data, reinterpret_cast<const void *>(address), size);
+}
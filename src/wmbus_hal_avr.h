@@ -0,0 +1,33 @@
+#ifndef WMBUS_HAL_AVR_H
+#define WMBUS_HAL_AVR_H
+
+#include <hal/hal_io.h>
+
+#include "wmbus_hal.h"
+
+// Node implementation: LMIC HalIo for the radio, LMIC clock, watchdog sleep and EEPROM.
+// wait_dio() needs the pin change interrupt of the DIO lines (pciSetup in main).
+class AvrWmbusHal final : public WmbusHal {
+public:
+  explicit AvrWmbusHal(lmic_pinmap const &pins);
+
+  uint8_t read_reg(uint8_t addr) override { return io.read_reg(addr); }
+  void write_reg(uint8_t addr, uint8_t data) override { io.write_reg(addr, data); }
+  void read_buffer(uint8_t addr, uint8_t *buf, uint8_t len) override { io.read_buffer(addr, buf, len); }
+  void write_buffer(uint8_t addr, const uint8_t *buf, uint8_t len) override { io.write_buffer(addr, buf, len); }
+  bool io_check0() override { return io.io_check0(); }
+  bool io_check1() override { return io.io_check1(); }
+  bool wait_dio(OsDeltaTime timeout) override;
+
+  OsTime time() override;
+  void sleep(OsDeltaTime duration) override;
+
+  uint16_t store_size() const override;
+  void store(uint16_t address, const void *data, uint8_t size) override;
+  void retrieve(uint16_t address, void *data, uint8_t size) override;
+
+private:
+  HalIo io;
+};
+
+#endif
@@ -0,0 +1,241 @@
+// Decoders of the node against EN 13757-4 vectors and encode/decode round trips,
+// batch decoders of the host tools against the decoder of the node.
+//
+// pio test -e native
+
+#include <unity.h>
+
+#include <array>
+#include <random>
+#include <vector>
+
+#include "3outof6.h"
+#include "batch_decoder.h"
+#include "frame_encoder.h"
+#include "izar.h"
+#include "mbus_packet.h"
+#include <lmic/bufferpack.h>
+
+namespace {
+const std::array<uint8_t, 6> METER_ID = {0x10, 0x20, 0x30, 0x07, 0x98, 0x01};
+
+// "3 out of 6" coding worked out by hand from the EN 13757-4 table:
+// 0 = 010110, 1 = 001101, 2 = 001110, 3 = 001011, 4 = 011100, 5 = 011001,
+// 9 = 100101, A = 100110, F = 101001, postamble 0101
+struct Vector {
+  uint8_t data[2];
+  bool lastByte;
+  uint8_t encoded[3];
+};
+
+const Vector vectors[] = {
+    {{0x12, 0x34}, false, {0x34, 0xE2, 0xDC}},
+    {{0x00, 0xFF}, false, {0x59, 0x6A, 0x69}},
+    {{0x44, 0x93}, false, {0x71, 0xC9, 0x4B}},
+    {{0xA5, 0x00}, true, {0x99, 0x95, 0x00}},
+};
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_encode_standard_vectors() {
+  for (const Vector &vector : vectors) {
+    uint8_t encoded[3] = {};
+    encode3outof6(vector.data, encoded, vector.lastByte);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(vector.encoded, encoded, vector.lastByte ? 2 : 3);
+  }
+}
+
+void test_decode_standard_vectors() {
+  for (const Vector &vector : vectors) {
+    uint8_t decoded[2] = {};
+    TEST_ASSERT_TRUE(decode3outof6(vector.encoded, decoded, vector.lastByte));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(vector.data, decoded, vector.lastByte ? 1 : 2);
+  }
+}
+
+void test_3outof6_round_trip() {
+  for (uint32_t value = 0; value < 0x10000; value++) {
+    const uint8_t data[2] = {static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)};
+    uint8_t encoded[3];
+    uint8_t decoded[2];
+    encode3outof6(data, encoded, false);
+    TEST_ASSERT_TRUE(decode3outof6(encoded, decoded, false));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, decoded, 2);
+  }
+}
+
+void test_3outof6_single_bit_error() {
+  // a flipped bit gives a symbol with 2 or 4 bits set
+  for (uint32_t value = 0; value < 0x10000; value += 7) {
+    const uint8_t data[2] = {static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)};
+    uint8_t encoded[3];
+    encode3outof6(data, encoded, false);
+    for (uint8_t bit = 0; bit < 24; bit++) {
+      uint8_t corrupted[3] = {encoded[0], encoded[1], encoded[2]};
+      corrupted[bit / 8] ^= 1 << (bit % 8);
+      uint8_t decoded[2];
+      TEST_ASSERT_FALSE(decode3outof6(corrupted, decoded, false));
+    }
+  }
+}
+
+void test_crc_check_value() {
+  // CRC-16/EN-13757 of "123456789"
+  CrcCalc crc = {};
+  for (const char *c = "123456789"; *c != 0; c++) {
+    crc.pushData(*c);
+  }
+  TEST_ASSERT_EQUAL_HEX16(0xC2B7, crc.value());
+  TEST_ASSERT_TRUE(crc.checkHigh(0xC2));
+  TEST_ASSERT_TRUE(crc.checkLow(0xB7));
+}
+
+void test_tmode_round_trip() {
+  for (uint32_t index = 0; index < 100; index++) {
+    const auto frame = buildIzarFrame<IzarLayout>(METER_ID, {0, 1, 2}, 100000 + index * 37);
+    const std::vector<uint8_t> encoded = encodeTmode(frame.begin(), frame.size());
+    TEST_ASSERT_EQUAL(IzarLayout::encodedSize, encoded.size());
+
+    std::array<uint8_t, IzarLayout::size> layoutPacket;
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(PacketDecodeResult::OK),
+                      static_cast<uint8_t>(decodeRXBytesTmode<IzarLayout>(encoded.data(), layoutPacket.begin())));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(frame.begin(), layoutPacket.begin(), frame.size());
+
+    std::array<uint8_t, IzarLayout::size> packet;
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(PacketDecodeResult::OK),
+                      static_cast<uint8_t>(decodeRXBytesTmode(encoded.data(), packet.begin(), packet.size())));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(frame.begin(), packet.begin(), frame.size());
+  }
+}
+
+void test_tmode_errors() {
+  const auto frame = buildIzarFrame<IzarLayout>(METER_ID, {0, 0, 0}, 123456);
+  const std::vector<uint8_t> encoded = encodeTmode(frame.begin(), frame.size());
+  std::array<uint8_t, IzarLayout::size> packet;
+
+  std::vector<uint8_t> coding = encoded;
+  coding[20] ^= 0x01;
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PacketDecodeResult::CODING_ERROR),
+                    static_cast<uint8_t>(decodeRXBytesTmode<IzarLayout>(coding.data(), packet.begin())));
+
+  // a valid coding of a wrong byte
+  auto wrong = frame;
+  wrong[5] ^= 0x10;
+  const std::vector<uint8_t> crc = encodeTmode(wrong.begin(), wrong.size());
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PacketDecodeResult::CRC_ERROR),
+                    static_cast<uint8_t>(decodeRXBytesTmode<IzarLayout>(crc.data(), packet.begin())));
+}
+
+void test_cmode_crc_round_trip() {
+  const auto frameA = buildIzarFrame<IzarLayout>(METER_ID, {0, 0, 0}, 42);
+  const auto frameB = buildIzarFrame<IzarLayoutB>(METER_ID, {0, 0, 0}, 42);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PacketDecodeResult::OK),
+                    static_cast<uint8_t>(checkRXBytesCmode<IzarLayout>(frameA.begin())));
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PacketDecodeResult::OK),
+                    static_cast<uint8_t>(checkRXBytesCmode<IzarLayoutB>(frameB.begin())));
+
+  // any single bit error is detected
+  for (uint16_t bit = 0; bit < frameA.size() * 8; bit++) {
+    auto corrupted = frameA;
+    corrupted[bit / 8] ^= 1 << (bit % 8);
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(PacketDecodeResult::CRC_ERROR),
+                      static_cast<uint8_t>(checkRXBytesCmode<IzarLayout>(corrupted.begin())));
+  }
+  for (uint16_t bit = 0; bit < frameB.size() * 8; bit++) {
+    auto corrupted = frameB;
+    corrupted[bit / 8] ^= 1 << (bit % 8);
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(PacketDecodeResult::CRC_ERROR),
+                      static_cast<uint8_t>(checkRXBytesCmode<IzarLayoutB>(corrupted.begin())));
+  }
+}
+
+void test_izar_extract() {
+  std::array<uint8_t, 7> reading;
+  const auto frameA = buildIzarFrame<IzarLayout>(METER_ID, {0x01, 0x02, 0x03}, 987654);
+  TEST_ASSERT_TRUE(printAndExtractIZAR<IzarLayout>(frameA.begin(), frameA.size(), METER_ID, reading));
+  TEST_ASSERT_EQUAL_HEX8(0x01, reading[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x03, reading[2]);
+  TEST_ASSERT_EQUAL_UINT32(987654, rlsbf4(reading.begin() + 3));
+
+  const auto frameB = buildIzarFrame<IzarLayoutB>(METER_ID, {0, 0, 0}, 4321);
+  TEST_ASSERT_TRUE(printAndExtractIZAR<IzarLayoutB>(frameB.begin(), frameB.size(), METER_ID, reading));
+  TEST_ASSERT_EQUAL_UINT32(4321, rlsbf4(reading.begin() + 3));
+
+  // another meter, then another key
+  const std::array<uint8_t, 6> other = {0x11, 0x20, 0x30, 0x07, 0x98, 0x01};
+  TEST_ASSERT_FALSE(printAndExtractIZAR<IzarLayout>(frameA.begin(), frameA.size(), other, reading));
+  const auto keyed = buildIzarFrame<IzarLayout>(METER_ID, {0, 0, 0}, 1, 0x1234ABCD);
+  TEST_ASSERT_FALSE(printAndExtractIZAR<IzarLayout>(keyed.begin(), keyed.size(), METER_ID, reading));
+  TEST_ASSERT_TRUE(printAndExtractIZAR<IzarLayout>(keyed.begin(), keyed.size(), METER_ID, reading, 0x1234ABCD));
+}
+
+void test_batch_decoders() {
+  // any size, half of them with the size of their L-field,
+  // 1/4 valid, 1/4 with a data bit error, 1/2 with 1 or 2 encoded bit errors
+  std::mt19937 random(1);
+  std::vector<TmodeDecoder> decoders = {TmodeDecoder::Scalar};
+  if (bestTmodeDecoder() != TmodeDecoder::Scalar) {
+    decoders.push_back(bestTmodeDecoder());
+  }
+  for (uint16_t i = 0; i < 4000; i++) {
+    const uint8_t lField = random();
+    const uint16_t size = i % 2 ? packetSize(lField) : 1 + random() % 300;
+    std::vector<uint8_t> packet(size);
+    for (auto &byte : packet) {
+      byte = random();
+    }
+    packet[0] = lField;
+    setCrcFields(packet.data(), size);
+    const uint8_t error = random() % 4;
+    if (error == 1) {
+      packet[random() % size] ^= 1 << (random() % 8);
+    }
+    std::vector<uint8_t> encoded = encodeTmode(packet.data(), size);
+    for (uint8_t n = 1; n < error; n++) {
+      encoded[random() % encoded.size()] ^= 1 << (random() % 8);
+    }
+
+    std::vector<uint8_t> expected(size);
+    const PacketDecodeResult reference = decodeRXBytesTmode(encoded.data(), expected.data(), size);
+    for (const TmodeDecoder decoder : decoders) {
+      std::vector<uint8_t> decoded(size);
+      TmodeFrame frame = {encoded.data(), decoded.data(), size, PacketDecodeResult::OK};
+      decodeTmodeBatch(&frame, 1, decoder);
+      TEST_ASSERT_EQUAL(static_cast<uint8_t>(reference), static_cast<uint8_t>(frame.result));
+      if (reference == PacketDecodeResult::OK) {
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), decoded.data(), size);
+      }
+    }
+  }
+}
+
+void test_crc_slice8() {
+  std::mt19937 random(2);
+  uint8_t data[300];
+  for (uint16_t length = 0; length < sizeof(data); length++) {
+    CrcCalc crc = {};
+    for (uint16_t i = 0; i < length; i++) {
+      data[i] = random();
+      crc.pushData(data[i]);
+    }
+    TEST_ASSERT_EQUAL_HEX16(crc.value(), crcSlice8(data, length));
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_encode_standard_vectors);
+  RUN_TEST(test_decode_standard_vectors);
+  RUN_TEST(test_3outof6_round_trip);
+  RUN_TEST(test_3outof6_single_bit_error);
+  RUN_TEST(test_crc_check_value);
+  RUN_TEST(test_tmode_round_trip);
+  RUN_TEST(test_tmode_errors);
+  RUN_TEST(test_cmode_crc_round_trip);
+  RUN_TEST(test_izar_extract);
+  RUN_TEST(test_batch_decoders);
+  RUN_TEST(test_crc_slice8);
+  return UNITY_END();
+}
@@ -0,0 +1,80 @@
+// Consumption summary of the readings: volume, flows, backflow and leak.
+//
+// pio test -e native
+
+#include <unity.h>
+
+#include "consumption.h"
+#include <lmic/bufferpack.h>
+
+void setUp() {}
+void tearDown() {}
+
+void test_consumption_summary() {
+  Consumption consumption;
+  consumption.addReading(1000, 0);
+  consumption.addReading(1010, 3600);
+  consumption.addReading(1030, 3600);
+
+  uint8_t summary[CONSUMPTION_SUMMARY_SIZE];
+  consumption.summary(summary);
+  TEST_ASSERT_EQUAL_UINT32(1030, rlsbf4(summary));
+  TEST_ASSERT_EQUAL_UINT16(30, rlsbf2(summary + 4));
+  // 10 and 20 L/h in 1/16 L/h
+  TEST_ASSERT_EQUAL_UINT16(160, rlsbf2(summary + 6));
+  TEST_ASSERT_EQUAL_UINT16(320, rlsbf2(summary + 8));
+  TEST_ASSERT_EQUAL_HEX8(0, summary[10]);
+  TEST_ASSERT_EQUAL_UINT8(3, summary[11]);
+
+  // next interval starts at the last index, without flow yet
+  consumption.summary(summary);
+  TEST_ASSERT_EQUAL_UINT16(0, rlsbf2(summary + 4));
+  TEST_ASSERT_EQUAL_UINT16(0, rlsbf2(summary + 6));
+  TEST_ASSERT_EQUAL_UINT8(0, summary[11]);
+}
+
+void test_consumption_backflow() {
+  Consumption consumption;
+  consumption.addReading(1000, 0);
+  consumption.addReading(990, 600);
+  uint8_t summary[CONSUMPTION_SUMMARY_SIZE];
+  consumption.summary(summary);
+  TEST_ASSERT_EQUAL_HEX8(CONSUMPTION_BACKFLOW, summary[10]);
+  // sent once
+  consumption.summary(summary);
+  TEST_ASSERT_EQUAL_HEX8(0, summary[10]);
+}
+
+void test_consumption_leak() {
+  Consumption consumption;
+  uint32_t index = 5000;
+  consumption.addReading(index, 0);
+  // 1 L every 30 min, never quiet for an hour
+  for (uint8_t reading = 0; reading < 47; reading++) {
+    consumption.addReading(++index, 1800);
+  }
+  TEST_ASSERT_FALSE(consumption.leak());
+  consumption.addReading(++index, 1800);
+  TEST_ASSERT_TRUE(consumption.leak());
+  TEST_ASSERT_TRUE(consumption.newLeak());
+
+  uint8_t summary[CONSUMPTION_SUMMARY_SIZE];
+  consumption.summary(summary);
+  TEST_ASSERT_EQUAL_HEX8(CONSUMPTION_LEAK, summary[10]);
+  TEST_ASSERT_TRUE(consumption.leak());
+  TEST_ASSERT_FALSE(consumption.newLeak());
+
+  // an hour without flow ends the leak
+  consumption.addReading(index, 1800);
+  TEST_ASSERT_TRUE(consumption.leak());
+  consumption.addReading(index, 1800);
+  TEST_ASSERT_FALSE(consumption.leak());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_consumption_summary);
+  RUN_TEST(test_consumption_backflow);
+  RUN_TEST(test_consumption_leak);
+  return UNITY_END();
+}
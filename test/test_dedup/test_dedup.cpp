@@ -0,0 +1,53 @@
+// Cache of the telegrams already forwarded: same CRC or reading, age and replacement.
+//
+// pio test -e native
+
+#include <unity.h>
+
+#include <array>
+
+#include "dedup.h"
+
+namespace {
+const OsTime START = OsTime{} + OsDeltaTime::from_sec(1000);
+
+OsTime at(uint32_t sec) { return START + OsDeltaTime::from_sec(sec); }
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_dedup_same_telegram() {
+  DedupCache dedup;
+  const uint8_t id[] = {0x10, 0x20, 0x30, 0x07, 0x98, 0x01};
+  const std::array<uint8_t, 7> reading = {0, 0, 0, 1, 2, 3, 4};
+  const std::array<uint8_t, 7> next = {0, 0, 0, 2, 2, 3, 4};
+  TEST_ASSERT_TRUE(dedup.accept(id, 0x1234, reading, at(0)));
+  // same CRC, then same reading
+  TEST_ASSERT_FALSE(dedup.accept(id, 0x1234, reading, at(10)));
+  TEST_ASSERT_FALSE(dedup.accept(id, 0x4321, reading, at(20)));
+  TEST_ASSERT_TRUE(dedup.accept(id, 0x4321, next, at(30)));
+  // forwarded again once the last one is too old
+  TEST_ASSERT_FALSE(dedup.accept(id, 0x4321, next, at(30 + DEDUP_MAX_AGE - 1)));
+  TEST_ASSERT_TRUE(dedup.accept(id, 0x4321, next, at(30 + DEDUP_MAX_AGE)));
+}
+
+void test_dedup_oldest_meter_replaced() {
+  DedupCache dedup;
+  uint8_t ids[DEDUP_CACHE_SIZE + 1][6] = {};
+  const std::array<uint8_t, 7> reading = {};
+  for (uint8_t meter = 0; meter <= DEDUP_CACHE_SIZE; meter++) {
+    ids[meter][0] = meter + 1;
+    TEST_ASSERT_TRUE(dedup.accept(ids[meter], 0x1000, reading, at(meter)));
+  }
+  // the first meter was replaced, the last ones are still known
+  TEST_ASSERT_TRUE(dedup.accept(ids[0], 0x1000, reading, at(10)));
+  TEST_ASSERT_FALSE(dedup.accept(ids[DEDUP_CACHE_SIZE], 0x1000, reading, at(11)));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_dedup_same_telegram);
+  RUN_TEST(test_dedup_oldest_meter_replaced);
+  return UNITY_END();
+}
@@ -0,0 +1,75 @@
+// Battery states of the power governor: thresholds, hysteresis, smoothing and level.
+//
+// pio test -e native
+
+#include <unity.h>
+
+#include "power_governor.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_power_states() {
+  PowerGovernor governor;
+  // a healthy NiMH pack
+  for (uint8_t sample = 0; sample < 50; sample++) {
+    governor.addSample(2300);
+  }
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PowerState::Normal), static_cast<uint8_t>(governor.state()));
+  TEST_ASSERT_TRUE(governor.policy().emptyUplink);
+
+  for (uint8_t sample = 0; sample < 50; sample++) {
+    governor.addSample(POWER_LOW_MV - 50);
+  }
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PowerState::Low), static_cast<uint8_t>(governor.state()));
+  TEST_ASSERT_EQUAL_UINT8(2, governor.policy().txIntervalFactor);
+  TEST_ASSERT_FALSE(governor.policy().emptyUplink);
+
+  for (uint8_t sample = 0; sample < 50; sample++) {
+    governor.addSample(POWER_CRITICAL_MV - 50);
+  }
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PowerState::Critical), static_cast<uint8_t>(governor.state()));
+  TEST_ASSERT_EQUAL_UINT8(6, governor.policy().txIntervalFactor);
+
+  // hysteresis: back above the critical threshold but not enough
+  for (uint8_t sample = 0; sample < 50; sample++) {
+    governor.addSample(POWER_CRITICAL_MV + POWER_HYSTERESIS_MV / 2);
+  }
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PowerState::Critical), static_cast<uint8_t>(governor.state()));
+  for (uint8_t sample = 0; sample < 50; sample++) {
+    governor.addSample(POWER_LOW_MV + 2 * POWER_HYSTERESIS_MV);
+  }
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PowerState::Normal), static_cast<uint8_t>(governor.state()));
+}
+
+void test_power_smoothing() {
+  PowerGovernor governor;
+  governor.addSample(2400);
+  // a single sample during a TX does not change the state
+  governor.addSample(1800);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(PowerState::Normal), static_cast<uint8_t>(governor.state()));
+  TEST_ASSERT_TRUE(governor.vcc() > POWER_LOW_MV);
+}
+
+void test_power_level() {
+  PowerGovernor governor;
+  governor.addSample(POWER_CRITICAL_MV - 100);
+  TEST_ASSERT_EQUAL_UINT8(1, governor.level());
+
+  PowerGovernor full;
+  full.addSample(3300);
+  TEST_ASSERT_EQUAL_UINT8(254, full.level());
+
+  // halfway between critical and full charge
+  PowerGovernor half;
+  half.addSample((POWER_CRITICAL_MV + POWER_FULL_MV) / 2);
+  TEST_ASSERT_UINT8_WITHIN(1, 127, half.level());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_power_states);
+  RUN_TEST(test_power_smoothing);
+  RUN_TEST(test_power_level);
+  return UNITY_END();
+}
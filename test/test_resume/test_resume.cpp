@@ -0,0 +1,85 @@
+// State resumed after a watchdog or brown-out reset: saved fields, corruption and rotating slots.
+//
+// pio test -e native
+
+#include <unity.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "fake_wmbus_hal.h"
+#include "resume.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_resume_state() {
+  FakeWmbusHal hal;
+  ResumeState state;
+  TEST_ASSERT_FALSE(loadResumeState(hal, state));
+
+  const ResumeState saved = {123456, {1, 2, 3, 4, 5, 6, 7}, true, 600, 2};
+  saveResumeState(hal, saved);
+  TEST_ASSERT_TRUE(loadResumeState(hal, state));
+  TEST_ASSERT_EQUAL_INT32(123456, state.nextListenMs);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(saved.pendingReading.begin(), state.pendingReading.begin(), 7);
+  TEST_ASSERT_TRUE(state.readingPending);
+  TEST_ASSERT_EQUAL_UINT16(600, state.pendingAgeSec);
+  TEST_ASSERT_EQUAL_UINT8(2, state.warmBoots);
+  // used only once
+  TEST_ASSERT_FALSE(loadResumeState(hal, state));
+}
+
+void test_resume_state_corrupted() {
+  FakeWmbusHal hal;
+  const ResumeState saved = {1000, {9, 8, 7, 6, 5, 4, 3}, true, 30, 1};
+  // a flipped bit is rejected, or is in the padding after the checksum
+  for (uint16_t offset = 0; offset < resumeStoreSize(); offset++) {
+    saveResumeState(hal, saved);
+    const uint16_t address = hal.store_size() - resumeStoreSize() + offset;
+    uint8_t byte;
+    hal.retrieve(address, &byte, 1);
+    byte ^= 0x01;
+    hal.store(address, &byte, 1);
+    ResumeState state;
+    if (loadResumeState(hal, state)) {
+      TEST_ASSERT_EQUAL_INT32(saved.nextListenMs, state.nextListenMs);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(saved.pendingReading.begin(), state.pendingReading.begin(), 7);
+      TEST_ASSERT_EQUAL_UINT8(saved.warmBoots, state.warmBoots);
+    }
+  }
+}
+
+void test_resume_state_slots() {
+  FakeWmbusHal hal;
+  ResumeState state;
+  // more saves than slots, with a load in the middle: the last one is loaded
+  for (int32_t save = 0; save < 20; save++) {
+    saveResumeState(hal, {save, {}, false, 0, 0});
+    if (save == 5) {
+      TEST_ASSERT_TRUE(loadResumeState(hal, state));
+      TEST_ASSERT_EQUAL_INT32(5, state.nextListenMs);
+    }
+  }
+  TEST_ASSERT_TRUE(loadResumeState(hal, state));
+  TEST_ASSERT_EQUAL_INT32(19, state.nextListenMs);
+  TEST_ASSERT_FALSE(loadResumeState(hal, state));
+
+  // each save writes another slot, the previous one is still there
+  saveResumeState(hal, {0x12345678, {}, false, 0, 0});
+  saveResumeState(hal, {0x23456789, {}, false, 0, 0});
+  std::vector<uint8_t> slots(resumeStoreSize());
+  hal.retrieve(hal.store_size() - resumeStoreSize(), slots.data(), slots.size());
+  const uint8_t first[] = {0x78, 0x56, 0x34, 0x12};
+  const uint8_t second[] = {0x89, 0x67, 0x45, 0x23};
+  TEST_ASSERT_TRUE(std::search(slots.begin(), slots.end(), first, first + 4) != slots.end());
+  TEST_ASSERT_TRUE(std::search(slots.begin(), slots.end(), second, second + 4) != slots.end());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_resume_state);
+  RUN_TEST(test_resume_state_corrupted);
+  RUN_TEST(test_resume_state_slots);
+  return UNITY_END();
+}
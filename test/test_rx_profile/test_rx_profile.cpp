@@ -0,0 +1,91 @@
+// RX calibration: scoring of the profiles and their store next to the resume state.
+//
+// pio test -e native
+
+#include <unity.h>
+
+#include "fake_wmbus_hal.h"
+#include "resume.h"
+#include "rx_profile.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_rx_calibration_ties() {
+  RxCalibration calibration;
+  calibration.start(2);
+  TEST_ASSERT_TRUE(calibration.running());
+  for (uint8_t candidate = 0; candidate < RxCalibration::nbCandidates(); candidate++) {
+    for (uint8_t window = 0; window < 2; window++) {
+      // same frames for candidates 1 and 2, stronger signal (lower value) for 2
+      if (candidate == 1 || candidate == 2) {
+        calibration.frameReceived(candidate == 1 ? 140 : 100);
+        calibration.frameReceived(candidate == 1 ? 140 : 100);
+      }
+      calibration.windowDone();
+    }
+  }
+  TEST_ASSERT_FALSE(calibration.running());
+
+  RxProfile best;
+  RxCalibrationStats stats;
+  TEST_ASSERT_TRUE(calibration.best(best, stats));
+  const RxProfile expected = RxCalibration::candidateProfile(2);
+  TEST_ASSERT_EQUAL_HEX8(expected.rxBw, best.rxBw);
+  TEST_ASSERT_EQUAL_HEX8(expected.lna, best.lna);
+  TEST_ASSERT_EQUAL_HEX8(expected.preambleDetect, best.preambleDetect);
+  TEST_ASSERT_EQUAL_UINT16(4, stats.frames);
+  TEST_ASSERT_EQUAL_UINT8(2, stats.windows);
+  TEST_ASSERT_EQUAL_UINT8(100, stats.meanRssi);
+}
+
+void test_rx_calibration_frames_first() {
+  RxCalibration calibration;
+  calibration.start(1);
+  for (uint8_t candidate = 0; candidate < RxCalibration::nbCandidates(); candidate++) {
+    // a strong signal on candidate 0, more frames on candidate 5
+    const uint8_t frames = candidate == 0 ? 2 : candidate == 5 ? 3 : 0;
+    for (uint8_t frame = 0; frame < frames; frame++) {
+      calibration.frameReceived(candidate == 0 ? 60 : 160);
+    }
+    calibration.windowDone();
+  }
+  RxProfile best;
+  RxCalibrationStats stats;
+  TEST_ASSERT_TRUE(calibration.best(best, stats));
+  TEST_ASSERT_EQUAL_UINT16(3, stats.frames);
+  TEST_ASSERT_EQUAL_HEX8(RxCalibration::candidateProfile(5).preambleDetect, best.preambleDetect);
+
+  calibration.start(1);
+  while (calibration.running()) {
+    calibration.windowDone();
+  }
+  TEST_ASSERT_FALSE(calibration.best(best, stats));
+}
+
+void test_rx_profile_store() {
+  FakeWmbusHal hal;
+  RxProfile profile;
+  RxCalibrationStats stats;
+  TEST_ASSERT_FALSE(loadRxProfile(hal, profile, stats));
+
+  // stored before the resume state, both are kept
+  const ResumeState resume = {500, {}, false, 0, 1};
+  saveResumeState(hal, resume);
+  saveRxProfile(hal, RxCalibration::candidateProfile(7), {12, 5, 130});
+  TEST_ASSERT_TRUE(loadRxProfile(hal, profile, stats));
+  TEST_ASSERT_EQUAL_HEX8(RxCalibration::candidateProfile(7).lna, profile.lna);
+  TEST_ASSERT_EQUAL_UINT16(12, stats.frames);
+  TEST_ASSERT_EQUAL_UINT8(130, stats.meanRssi);
+  ResumeState state;
+  TEST_ASSERT_TRUE(loadResumeState(hal, state));
+  TEST_ASSERT_EQUAL_INT32(500, state.nextListenMs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_rx_calibration_ties);
+  RUN_TEST(test_rx_calibration_frames_first);
+  RUN_TEST(test_rx_profile_store);
+  return UNITY_END();
+}
@@ -0,0 +1,64 @@
+// Radio scheduler: listen windows interleaved with the LMIC jobs.
+//
+// pio test -e native
+
+#include <unity.h>
+
+#include "radio_scheduler.h"
+
+namespace {
+const OsTime START = OsTime{} + OsDeltaTime::from_sec(1000);
+
+OsTime at(uint32_t sec, uint32_t ms = 0) { return START + OsDeltaTime::from_sec(sec) + OsDeltaTime::from_ms(ms); }
+
+uint8_t task(RadioTask value) { return static_cast<uint8_t>(value); }
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_scheduler_preempt_and_resume() {
+  RadioScheduler scheduler;
+  // LMIC has a job in 20 s
+  scheduler.lmicRun(at(0), OsDeltaTime::from_sec(20), false);
+  TEST_ASSERT_EQUAL(task(RadioTask::Lmic), task(scheduler.next(at(0))));
+
+  scheduler.openListen(OsDeltaTime::from_sec(40));
+  TEST_ASSERT_EQUAL(task(RadioTask::Listen), task(scheduler.next(at(0))));
+  TEST_ASSERT_EQUAL(task(RadioTask::Listen), task(scheduler.next(at(19))));
+  // suspended 100 ms before the job, 20 s of listen left
+  TEST_ASSERT_EQUAL(task(RadioTask::Preempt), task(scheduler.next(at(19, 950))));
+  TEST_ASSERT_TRUE(scheduler.listenOpen());
+  TEST_ASSERT_FALSE(scheduler.listenExpired(at(19, 950)));
+  TEST_ASSERT_EQUAL(task(RadioTask::Lmic), task(scheduler.next(at(19, 950))));
+
+  // resumed after the job for the time left
+  scheduler.lmicRun(at(21), OsDeltaTime::from_sec(60), false);
+  TEST_ASSERT_EQUAL(task(RadioTask::Listen), task(scheduler.next(at(21))));
+  TEST_ASSERT_FALSE(scheduler.listenExpired(at(41)));
+  TEST_ASSERT_TRUE(scheduler.listenExpired(at(41, 100)));
+  scheduler.closeListen();
+  TEST_ASSERT_FALSE(scheduler.listenOpen());
+  TEST_ASSERT_EQUAL(task(RadioTask::Lmic), task(scheduler.next(at(42))));
+}
+
+void test_scheduler_waits_for_lmic() {
+  RadioScheduler scheduler;
+  scheduler.openListen(OsDeltaTime::from_sec(40));
+  // TX or RX window pending
+  scheduler.lmicRun(at(0), OsDeltaTime::from_sec(60), true);
+  TEST_ASSERT_EQUAL(task(RadioTask::Lmic), task(scheduler.next(at(0))));
+  // less than 2 s before the next job
+  scheduler.lmicRun(at(1), OsDeltaTime::from_sec(1), false);
+  TEST_ASSERT_FALSE(scheduler.listenReady(at(1)));
+  TEST_ASSERT_EQUAL(task(RadioTask::Lmic), task(scheduler.next(at(1))));
+  scheduler.lmicRun(at(3), OsDeltaTime::from_sec(60), false);
+  TEST_ASSERT_EQUAL(task(RadioTask::Listen), task(scheduler.next(at(3))));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_scheduler_preempt_and_resume);
+  RUN_TEST(test_scheduler_waits_for_lmic);
+  return UNITY_END();
+}
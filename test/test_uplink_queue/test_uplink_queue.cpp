@@ -0,0 +1,104 @@
+// Readings queued for the uplinks of a stationary node: packing, overflow and airtime.
+//
+// pio test -e native
+
+#include <unity.h>
+
+#include "uplink_queue.h"
+#include <lmic/bufferpack.h>
+
+namespace {
+const OsTime START = OsTime{} + OsDeltaTime::from_sec(1000);
+
+OsTime at(uint32_t sec) { return START + OsDeltaTime::from_sec(sec); }
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_reading_queue_pack() {
+  TEST_ASSERT_EQUAL_UINT8(5, ReadingQueue::capacity(maxPayloadSize(0)));
+  TEST_ASSERT_EQUAL_UINT8(12, ReadingQueue::capacity(maxPayloadSize(3)));
+
+  ReadingQueue queue;
+  for (uint8_t i = 0; i < 3; i++) {
+    queue.push({i, 0, 0, static_cast<uint8_t>(0x10 + i), 0, 0, 0}, at(i * 60));
+  }
+  uint8_t buffer[51];
+  TEST_ASSERT_EQUAL_UINT8(3, queue.pack(buffer, sizeof(buffer), at(600)));
+  // age in minutes, flags, index
+  TEST_ASSERT_EQUAL_UINT16(10, rlsbf2(buffer));
+  TEST_ASSERT_EQUAL_HEX8(0x10, buffer[5]);
+  TEST_ASSERT_EQUAL_UINT16(8, rlsbf2(buffer + 2 * READING_RECORD_SIZE));
+  TEST_ASSERT_EQUAL_HEX8(0x12, buffer[2 * READING_RECORD_SIZE + 5]);
+
+  // only the sent ones are removed
+  TEST_ASSERT_EQUAL_UINT8(2, queue.pack(buffer, 2 * READING_RECORD_SIZE, at(600)));
+  queue.pop(2);
+  TEST_ASSERT_EQUAL_UINT8(1, queue.size());
+  TEST_ASSERT_EQUAL_UINT8(1, queue.pack(buffer, sizeof(buffer), at(600)));
+  TEST_ASSERT_EQUAL_HEX8(0x12, buffer[5]);
+}
+
+void test_reading_queue_overflow() {
+  ReadingQueue queue;
+  for (uint8_t i = 0; i <= READING_QUEUE_SIZE; i++) {
+    queue.push({i, 0, 0, 0, 0, 0, 0}, at(i));
+  }
+  TEST_ASSERT_EQUAL_UINT8(READING_QUEUE_SIZE, queue.size());
+  uint8_t buffer[READING_RECORD_SIZE];
+  TEST_ASSERT_EQUAL_UINT8(1, queue.pack(buffer, sizeof(buffer), at(100)));
+  // the oldest reading was dropped
+  TEST_ASSERT_EQUAL_HEX8(1, buffer[2]);
+}
+
+void test_reading_queue_in_uplink() {
+  ReadingQueue queue;
+  for (uint8_t i = 0; i < 3; i++) {
+    queue.push({i, 0, 0, 0, 0, 0, 0}, at(i));
+  }
+  uint8_t buffer[2 * READING_RECORD_SIZE];
+  queue.setSent(queue.pack(buffer, sizeof(buffer), at(10)));
+  TEST_ASSERT_EQUAL_UINT8(2, queue.inUplink());
+  // still queued while LMIC holds the uplink
+  TEST_ASSERT_EQUAL_UINT8(3, queue.size());
+  queue.push({3, 0, 0, 0, 0, 0, 0}, at(20));
+  queue.txComplete();
+  TEST_ASSERT_EQUAL_UINT8(2, queue.size());
+  TEST_ASSERT_EQUAL_UINT8(0, queue.inUplink());
+  TEST_ASSERT_EQUAL_UINT8(2, queue.pack(buffer, sizeof(buffer), at(30)));
+  TEST_ASSERT_EQUAL_HEX8(2, buffer[2]);
+  TEST_ASSERT_EQUAL_HEX8(3, buffer[READING_RECORD_SIZE + 2]);
+}
+
+void test_reading_queue_overflow_in_uplink() {
+  ReadingQueue queue;
+  for (uint8_t i = 0; i < READING_QUEUE_SIZE; i++) {
+    queue.push({i, 0, 0, 0, 0, 0, 0}, at(i));
+  }
+  queue.setSent(2);
+  // the dropped reading was in the uplink, only the other one is removed after it
+  queue.push({READING_QUEUE_SIZE, 0, 0, 0, 0, 0, 0}, at(100));
+  TEST_ASSERT_EQUAL_UINT8(1, queue.inUplink());
+  queue.txComplete();
+  TEST_ASSERT_EQUAL_UINT8(READING_QUEUE_SIZE - 1, queue.size());
+  uint8_t buffer[READING_RECORD_SIZE];
+  TEST_ASSERT_EQUAL_UINT8(1, queue.pack(buffer, sizeof(buffer), at(100)));
+  TEST_ASSERT_EQUAL_HEX8(2, buffer[2]);
+}
+
+void test_uplink_airtime() {
+  // 9 bytes of payload at SF7 125 kHz: 55.25 symbols of 1.024 ms
+  TEST_ASSERT_EQUAL_INT32(56, uplinkAirtime(5, 9).to_ms());
+  TEST_ASSERT_TRUE(uplinkAirtime(0, 9) > uplinkAirtime(1, 9));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reading_queue_pack);
+  RUN_TEST(test_reading_queue_overflow);
+  RUN_TEST(test_reading_queue_in_uplink);
+  RUN_TEST(test_reading_queue_overflow_in_uplink);
+  RUN_TEST(test_uplink_airtime);
+  return UNITY_END();
+}
@@ -0,0 +1,271 @@
+// Decode the frames of several radios concurrently.
+//
+// usage: collector [-q] [-s] [-w WORKERS] [-r REPEAT] [-b] CAPTURE...
+//   -q          only print statistics
+//   -s          decode the T1 frames with the firmware decoder instead of the batch decoder
+//   -w WORKERS  number of decode workers (default: number of cores)
+//   -r REPEAT   deliver the frames of each capture REPEAT times
+//   -b          benchmark: decode with 1, 2, 4... workers and print the throughput
+// Each CAPTURE is delivered by its own RX thread, as the frames of one radio.
+// RX threads hand the frames to the workers through SPSC queues, the results
+// are published in the reception order of each radio, and only the readings
+// newer than the last one published for the meter.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "batch_decoder.h"
+#include "capture_file.h"
+#include "frame_decoder.h"
+#include "frame_text.h"
+#include "spsc_queue.h"
+#include <lmic/bufferpack.h>
+
+namespace {
+
+constexpr size_t QUEUE_SIZE = 256;
+
+struct Job {
+  uint32_t seq;
+  CaptureHeader header;
+  std::array<uint8_t, 255> raw;
+};
+
+struct Result {
+  uint32_t seq;
+  uint8_t source;
+  CaptureHeader header;
+  FrameResult frame;
+};
+
+using JobQueue = SpscQueue<Job, QUEUE_SIZE>;
+using ResultQueue = SpscQueue<Result, QUEUE_SIZE>;
+
+struct MeterStats {
+  uint32_t readings = 0;
+  // reading not newer than the last one published (repeated or received by another radio)
+  uint32_t duplicates = 0;
+  std::array<uint8_t, 7> last = {};
+};
+
+struct Stats {
+  std::array<uint32_t, NB_FRAME_STATUS> status = {};
+  std::map<std::array<uint8_t, 6>, MeterStats> meters;
+  uint64_t frames = 0;
+};
+
+void usage() { fprintf(stderr, "usage: collector [-q] [-s] [-w WORKERS] [-r REPEAT] [-b] CAPTURE...\n"); }
+
+template <typename Queue, typename T> void pushWait(Queue &queue, T &&value) {
+  while (!queue.push(std::move(value)))
+    std::this_thread::yield();
+}
+
+// Frames of one radio, dispatched round robin to the workers
+void rxThread(const std::vector<CaptureRecord> &records, uint32_t repeat,
+              std::vector<std::unique_ptr<JobQueue>> &queues) {
+  uint32_t seq = 0;
+  for (uint32_t round = 0; round < repeat; round++) {
+    for (const auto &record : records) {
+      Job job;
+      job.seq = seq;
+      job.header = record.header;
+      std::copy(record.raw.begin(), record.raw.end(), job.raw.begin());
+      pushWait(*queues[seq % queues.size()], std::move(job));
+      seq++;
+    }
+  }
+}
+
+void workerThread(std::vector<JobQueue *> inputs, ResultQueue &output, const std::atomic<uint8_t> &rxDone,
+                  uint8_t nbSources, TmodeDecodeFunction decodeTmode) {
+  Job job;
+  for (;;) {
+    // read before checking the queues, the last jobs are seen after the RX threads end
+    const bool finished = rxDone.load(std::memory_order_acquire) == nbSources;
+    bool busy = false;
+    for (uint8_t source = 0; source < inputs.size(); source++) {
+      while (inputs[source]->pop(job)) {
+        busy = true;
+        pushWait(output, Result{job.seq, source, job.header, decodeRaw(job.header, job.raw.data(), decodeTmode)});
+      }
+    }
+    if (!busy) {
+      if (finished)
+        return;
+      std::this_thread::yield();
+    }
+  }
+}
+
+void publish(const Result &result, bool quiet, Stats &stats) {
+  stats.frames++;
+  stats.status[static_cast<uint8_t>(result.frame.status)]++;
+  if (result.frame.status == FrameStatus::OK) {
+    auto &meter = stats.meters[result.frame.id];
+    // the index of a meter never decreases, keep the readings of each meter in order across radios
+    if (meter.readings > 0 && rlsbf4(result.frame.reading.begin() + 3) <= rlsbf4(meter.last.begin() + 3)) {
+      meter.duplicates++;
+      return;
+    }
+    meter.readings++;
+    meter.last = result.frame.reading;
+  }
+  if (!quiet) {
+    printf("radio %u ", result.source);
+    printFrame(result.header, result.frame);
+  }
+}
+
+// Run the RX threads, the workers and publish in the calling thread, return the elapsed time
+double collect(const std::vector<std::vector<CaptureRecord>> &sources, uint32_t repeat, uint32_t nbWorkers,
+               TmodeDecodeFunction decodeTmode, bool quiet, Stats &stats) {
+  const uint8_t nbSources = sources.size();
+  // one queue from each source to each worker, one queue from each worker to the publisher
+  std::vector<std::vector<std::unique_ptr<JobQueue>>> jobQueues(nbSources);
+  for (auto &queues : jobQueues) {
+    for (uint32_t worker = 0; worker < nbWorkers; worker++)
+      queues.push_back(std::make_unique<JobQueue>());
+  }
+  std::vector<std::unique_ptr<ResultQueue>> resultQueues;
+  for (uint32_t worker = 0; worker < nbWorkers; worker++)
+    resultQueues.push_back(std::make_unique<ResultQueue>());
+
+  uint64_t total = 0;
+  for (const auto &records : sources)
+    total += static_cast<uint64_t>(records.size()) * repeat;
+
+  const auto start = std::chrono::steady_clock::now();
+  std::atomic<uint8_t> rxDone{0};
+  std::vector<std::thread> threads;
+  for (uint32_t worker = 0; worker < nbWorkers; worker++) {
+    std::vector<JobQueue *> inputs;
+    for (auto &queues : jobQueues)
+      inputs.push_back(queues[worker].get());
+    threads.emplace_back(workerThread, inputs, std::ref(*resultQueues[worker]), std::cref(rxDone), nbSources,
+                         decodeTmode);
+  }
+  for (uint8_t source = 0; source < nbSources; source++) {
+    threads.emplace_back([&, source]() {
+      rxThread(sources[source], repeat, jobQueues[source]);
+      rxDone.fetch_add(1, std::memory_order_release);
+    });
+  }
+
+  // results of a source arrive out of order from the workers
+  std::vector<uint32_t> nextSeq(nbSources, 0);
+  std::vector<std::map<uint32_t, Result>> pending(nbSources);
+  uint64_t published = 0;
+  Result result;
+  while (published < total) {
+    bool busy = false;
+    for (auto &queue : resultQueues) {
+      while (queue->pop(result)) {
+        busy = true;
+        auto &waiting = pending[result.source];
+        if (result.seq != nextSeq[result.source]) {
+          waiting.emplace(result.seq, result);
+          continue;
+        }
+        publish(result, quiet, stats);
+        published++;
+        nextSeq[result.source]++;
+        for (auto next = waiting.begin(); next != waiting.end() && next->first == nextSeq[result.source];
+             next = waiting.erase(next)) {
+          publish(next->second, quiet, stats);
+          published++;
+          nextSeq[result.source]++;
+        }
+      }
+    }
+    if (!busy)
+      std::this_thread::yield();
+  }
+
+  for (auto &thread : threads)
+    thread.join();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printStats(const Stats &stats) {
+  for (uint8_t status = 0; status < NB_FRAME_STATUS; status++) {
+    printf("  %-12s %u\n", frameStatusName(static_cast<FrameStatus>(status)), stats.status[status]);
+  }
+  printf("%zu meters\n", stats.meters.size());
+  for (const auto &meter : stats.meters) {
+    const uint32_t index = rlsbf4(meter.second.last.begin() + 3);
+    printf("  %s readings %u duplicates %u last idx %u.%03u\n", hex(meter.first.begin(), meter.first.size()).c_str(),
+           meter.second.readings, meter.second.duplicates, index / 1000, index % 1000);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool quiet = false;
+  bool bench = false;
+  TmodeDecodeFunction decodeTmode = decodeTmodeFast;
+  uint32_t nbWorkers = std::max(1u, std::thread::hardware_concurrency());
+  uint32_t repeat = 1;
+  std::vector<std::vector<CaptureRecord>> sources;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0) {
+      quiet = true;
+    } else if (strcmp(argv[i], "-s") == 0) {
+      decodeTmode = decodeRXBytesTmode;
+    } else if (strcmp(argv[i], "-b") == 0) {
+      bench = true;
+    } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+      nbWorkers = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      repeat = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (argv[i][0] == '-') {
+      usage();
+      return 1;
+    } else {
+      sources.emplace_back();
+      if (!readCaptureFile(argv[i], sources.back())) {
+        fprintf(stderr, "Can not read capture %s\n", argv[i]);
+        return 1;
+      }
+    }
+  }
+  if (sources.empty() || sources.size() > 255) {
+    usage();
+    return 1;
+  }
+
+  if (bench) {
+    std::vector<uint32_t> counts;
+    for (uint32_t count = 1; count < nbWorkers; count *= 2)
+      counts.push_back(count);
+    counts.push_back(nbWorkers);
+    printf("%zu radios, %s T1 decoder\n", sources.size(),
+           decodeTmode == decodeTmodeFast ? tmodeDecoderName(bestTmodeDecoder()) : "firmware");
+    for (uint32_t count : counts) {
+      Stats stats;
+      const double seconds = collect(sources, repeat, count, decodeTmode, true, stats);
+      printf("  %2u workers: %llu frames in %.3f ms (%.0f frames/s)\n", count,
+             static_cast<unsigned long long>(stats.frames), seconds * 1000, stats.frames / seconds);
+    }
+    return 0;
+  }
+
+  Stats stats;
+  const double seconds = collect(sources, repeat, nbWorkers, decodeTmode, quiet, stats);
+  printf("%llu frames from %zu radios with %u workers in %.3f ms (%.0f frames/s)\n",
+         static_cast<unsigned long long>(stats.frames), sources.size(), nbWorkers, seconds * 1000,
+         stats.frames / seconds);
+  printStats(stats);
+  return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+
+// Lock-free queue with one producer thread and one consumer thread.
+// N must be a power of 2, N - 1 elements can be queued.
+template <typename T, size_t N> class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "size must be a power of 2");
+
+public:
+  // Producer side, false if the queue is full
+  bool push(T &&value) {
+    const size_t tail = tailIndex.load(std::memory_order_relaxed);
+    const size_t next = (tail + 1) & (N - 1);
+    if (next == headCache) {
+      headCache = headIndex.load(std::memory_order_acquire);
+      if (next == headCache)
+        return false;
+    }
+    items[tail] = std::move(value);
+    tailIndex.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side, false if the queue is empty
+  bool pop(T &value) {
+    const size_t head = headIndex.load(std::memory_order_relaxed);
+    if (head == tailCache) {
+      tailCache = tailIndex.load(std::memory_order_acquire);
+      if (head == tailCache)
+        return false;
+    }
+    value = std::move(items[head]);
+    headIndex.store((head + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool empty() const { return headIndex.load(std::memory_order_relaxed) == tailIndex.load(std::memory_order_acquire); }
+
+private:
+  static constexpr size_t CACHE_LINE = 64;
+
+  // written by the consumer
+  alignas(CACHE_LINE) std::atomic<size_t> headIndex{0};
+  size_t tailCache = 0;
+  // written by the producer
+  alignas(CACHE_LINE) std::atomic<size_t> tailIndex{0};
+  size_t headCache = 0;
+  alignas(CACHE_LINE) std::array<T, N> items;
+};
+
+#endif
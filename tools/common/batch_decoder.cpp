@@ -0,0 +1,246 @@
+#include "batch_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "frame_encoder.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_DECODER_SSSE3
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Block lengths with the CRC field (frame format A)
+constexpr uint16_t FIRST_BLOCK_LENGTH = 12;
+constexpr uint16_t BLOCK_LENGTH = 18;
+
+// CRC register after shifting the upper bits of value through the polynom
+constexpr uint16_t crcShift(uint16_t value, uint8_t nbBits) {
+  for (uint8_t i = 0; i < nbBits; i++) {
+    value = (value & 0x8000) ? (value << 1) ^ CrcCalc::CRC_POLYNOM : (value << 1);
+  }
+  return value;
+}
+
+// values[k][byte]: CRC register of byte followed by k zero bytes
+struct SliceTables {
+  uint16_t values[8][256];
+};
+
+constexpr SliceTables makeSliceTables() {
+  SliceTables tab = {};
+  for (uint16_t byte = 0; byte < 256; byte++) {
+    tab.values[0][byte] = crcShift(byte << 8, 8);
+  }
+  for (uint8_t k = 1; k < 8; k++) {
+    for (uint16_t byte = 0; byte < 256; byte++) {
+      const uint16_t previous = tab.values[k - 1][byte];
+      tab.values[k][byte] = (previous << 8) ^ tab.values[0][previous >> 8];
+    }
+  }
+  return tab;
+}
+
+constexpr SliceTables sliceTables = makeSliceTables();
+
+// CRC register of data, 8 bytes per round
+template <typename T> constexpr uint16_t sliceRegister(const T *data, uint16_t length) {
+  const auto &tab = sliceTables.values;
+  uint16_t reg = 0;
+  for (; length >= 8; data += 8, length -= 8) {
+    reg = tab[7][static_cast<uint8_t>(data[0]) ^ (reg >> 8)] ^ tab[6][static_cast<uint8_t>(data[1]) ^ (reg & 0xFF)] ^
+          tab[5][static_cast<uint8_t>(data[2])] ^ tab[4][static_cast<uint8_t>(data[3])] ^
+          tab[3][static_cast<uint8_t>(data[4])] ^ tab[2][static_cast<uint8_t>(data[5])] ^
+          tab[1][static_cast<uint8_t>(data[6])] ^ tab[0][static_cast<uint8_t>(data[7])];
+  }
+  for (; length > 0; data++, length--) {
+    reg = (reg << 8) ^ tab[0][(reg >> 8) ^ static_cast<uint8_t>(*data)];
+  }
+  return reg;
+}
+
+static_assert(static_cast<uint16_t>(~sliceRegister("123456789", 9)) == 0xC2B7,
+              "slicing tables do not match CRC-16/EN-13757");
+
+// Result of a decoded packet, in the order of decodeRXBytesTmode: a block is
+// decoded before checking its CRC field, and the CRC high byte of an odd last
+// block before decoding the last byte. firstInvalid is the first byte with
+// an invalid symbol, size if none.
+PacketDecodeResult checkBlocks(const uint8_t *packet, uint16_t size, uint16_t firstInvalid) {
+  uint16_t start = 0;
+  uint16_t end = std::min(FIRST_BLOCK_LENGTH, size);
+  while (start < size) {
+    if (end - start == 1) {
+      // only the low byte of the CRC field of an empty block
+      if (firstInvalid < end)
+        return PacketDecodeResult::CODING_ERROR;
+      if (packet[start] != 0xFF)
+        return PacketDecodeResult::CRC_ERROR;
+    } else {
+      if (firstInvalid < (end % 2 ? end - 1 : end))
+        return PacketDecodeResult::CODING_ERROR;
+      const uint16_t crcStart = end - 2;
+      const uint16_t crc = ~sliceRegister(packet + start, crcStart - start);
+      if (packet[crcStart] != (crc >> 8))
+        return PacketDecodeResult::CRC_ERROR;
+      if (firstInvalid < end)
+        return PacketDecodeResult::CODING_ERROR;
+      if (packet[crcStart + 1] != (crc & 0xFF))
+        return PacketDecodeResult::CRC_ERROR;
+    }
+    start = end;
+    end = std::min<uint16_t>(end + BLOCK_LENGTH, size);
+  }
+  return PacketDecodeResult::OK;
+}
+
+PacketDecodeResult decodeScalar(const uint8_t *encoded, uint8_t *packet, uint16_t size) {
+  uint16_t firstInvalid = size;
+  uint16_t i = 0;
+  for (; i + 1 < size; i += 2) {
+    if (!decode3outof6(encoded + i / 2 * 3, packet + i, false)) {
+      firstInvalid = i;
+      break;
+    }
+  }
+  if (firstInvalid == size && i < size && !decode3outof6(encoded + i / 2 * 3, packet + i, true))
+    firstInvalid = i;
+  return checkBlocks(packet, size, firstInvalid);
+}
+
+#ifdef BATCH_DECODER_SSSE3
+
+// Nibble of each symbol, 0x80 if it is not a valid "3 out of 6" coding.
+// Built from the encoder of the host tools, as 4 pshufb tables of 16 symbols.
+struct SymbolTables {
+  alignas(16) uint8_t values[64];
+};
+
+SymbolTables makeSymbolTables() {
+  SymbolTables tables;
+  std::fill_n(tables.values, sizeof(tables.values), 0x80);
+  for (uint8_t nibble = 0; nibble < 16; nibble++) {
+    const uint8_t data = nibble << 4;
+    uint8_t encoded[2];
+    encode3outof6(&data, encoded, true);
+    tables.values[encoded[0] >> 2] = nibble;
+  }
+  return tables;
+}
+
+const SymbolTables symbolTables = makeSymbolTables();
+
+// Decode the 16 symbols of the first 12 bytes of input into 8 bytes.
+// Return a bit per symbol, set if the symbol is invalid.
+__attribute__((target("ssse3"))) inline uint16_t decodeGroup(__m128i input, uint8_t *decoded) {
+  // 3 bytes in each 32-bit lane, big endian in each 16-bit word
+  const __m128i lanes = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  // move the 4 symbols of a lane to the low bits of its bytes, in order
+  const __m128i high = _mm_mulhi_epu16(_mm_and_si128(lanes, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+  const __m128i low = _mm_mullo_epi16(_mm_and_si128(lanes, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+  const __m128i symbols = _mm_or_si128(high, low);
+
+  // a symbol out of the 16 symbols of a table gets an index with bit 7 set, the lookup gives 0
+  __m128i nibbles = _mm_setzero_si128();
+  for (uint8_t table = 0; table < 4; table++) {
+    const __m128i lookup = _mm_load_si128(reinterpret_cast<const __m128i *>(symbolTables.values + table * 16));
+    const __m128i index = _mm_adds_epu8(_mm_xor_si128(symbols, _mm_set1_epi8(table * 16)), _mm_set1_epi8(0x70));
+    nibbles = _mm_or_si128(nibbles, _mm_shuffle_epi8(lookup, index));
+  }
+
+  // high nibble * 16 + low nibble
+  const __m128i bytes = _mm_maddubs_epi16(nibbles, _mm_set1_epi16(0x0110));
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(decoded), _mm_packus_epi16(bytes, bytes));
+  return _mm_movemask_epi8(nibbles);
+}
+
+// The length bytes left at encoded, at the start of the register. Read from the 16 bytes
+// ending at end if the frame is long enough, else from a padded copy.
+__attribute__((target("ssse3"))) inline __m128i loadTail(const uint8_t *encoded, uint8_t length, uint16_t end) {
+  if (end < 16) {
+    uint8_t padded[16] = {};
+    std::copy_n(encoded, length, padded);
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(padded));
+  }
+  // shift the bytes down, the indexes out of the register get bit 7 set (zero)
+  const __m128i shift = _mm_add_epi8(_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                     _mm_set1_epi8(16 - length));
+  const __m128i index = _mm_or_si128(shift, _mm_cmpgt_epi8(shift, _mm_set1_epi8(15)));
+  return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(encoded + length - 16)), index);
+}
+
+__attribute__((target("ssse3"))) PacketDecodeResult decodeSsse3(const uint8_t *encoded, uint8_t *packet,
+                                                                uint16_t size) {
+  const uint16_t encodedLength = (size * 3 + 1) / 2;
+  uint16_t firstInvalid = size;
+  uint16_t in = 0;
+  uint16_t out = 0;
+  // symbols of the padding and of the postamble are after size, firstInvalid is bounded at the end
+  for (; in + 16 <= encodedLength; in += 12, out += 8) {
+    const uint16_t invalid = decodeGroup(_mm_loadu_si128(reinterpret_cast<const __m128i *>(encoded + in)), packet + out);
+    if (invalid != 0 && firstInvalid == size)
+      firstInvalid = out + __builtin_ctz(invalid) / 2;
+  }
+  // less than 16 bytes left, 1 or 2 groups
+  __m128i tail = loadTail(encoded + in, encodedLength - in, encodedLength);
+  for (; out < size; out += 8) {
+    uint8_t decoded[8];
+    const uint16_t invalid = decodeGroup(tail, decoded);
+    std::copy_n(decoded, std::min<uint16_t>(8, size - out), packet + out);
+    if (invalid != 0 && firstInvalid == size)
+      firstInvalid = out + __builtin_ctz(invalid) / 2;
+    tail = _mm_srli_si128(tail, 12);
+  }
+  return checkBlocks(packet, size, std::min(firstInvalid, size));
+}
+
+#endif
+
+bool ssse3Supported() {
+#ifdef BATCH_DECODER_SSSE3
+  static const bool supported = __builtin_cpu_supports("ssse3");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+using DecodeFunction = PacketDecodeResult (*)(const uint8_t *, uint8_t *, uint16_t);
+
+DecodeFunction decodeFunction(TmodeDecoder decoder) {
+#ifdef BATCH_DECODER_SSSE3
+  if (decoder == TmodeDecoder::Ssse3 && ssse3Supported())
+    return decodeSsse3;
+#endif
+  (void)decoder;
+  return decodeScalar;
+}
+
+} // namespace
+
+TmodeDecoder bestTmodeDecoder() { return ssse3Supported() ? TmodeDecoder::Ssse3 : TmodeDecoder::Scalar; }
+
+const char *tmodeDecoderName(TmodeDecoder decoder) {
+  switch (decoder) {
+  case TmodeDecoder::Ssse3:
+    return "ssse3";
+  default:
+    return "scalar";
+  }
+}
+
+void decodeTmodeBatch(TmodeFrame *frames, size_t count, TmodeDecoder decoder) {
+  const DecodeFunction decode = decodeFunction(decoder);
+  for (size_t i = 0; i < count; i++) {
+    frames[i].result = decode(frames[i].encoded, frames[i].packet, frames[i].size);
+  }
+}
+
+PacketDecodeResult decodeTmodeFast(const uint8_t *pByte, uint8_t *pPacket, uint16_t packetSize) {
+  static const DecodeFunction decode = decodeFunction(bestTmodeDecoder());
+  return decode(pByte, pPacket, packetSize);
+}
+
+uint16_t crcSlice8(const uint8_t *data, uint16_t length) { return ~sliceRegister(data, length); }
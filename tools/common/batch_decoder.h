@@ -0,0 +1,39 @@
+#ifndef BATCH_DECODER_H
+#define BATCH_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mbus_packet.h"
+
+// Host decoders of T mode frames, with the same results as decodeRXBytesTmode
+// (the packet is only complete when the result is OK).
+enum class TmodeDecoder : uint8_t {
+  // firmware "3 out of 6" decoding, slicing-by-8 CRC
+  Scalar = 0,
+  // pshufb symbol lookup, 16 symbols at a time, slicing-by-8 CRC
+  Ssse3,
+};
+
+// Fastest decoder supported by the CPU
+TmodeDecoder bestTmodeDecoder();
+const char *tmodeDecoderName(TmodeDecoder decoder);
+
+struct TmodeFrame {
+  // (size * 3 + 1) / 2 encoded bytes
+  const uint8_t *encoded;
+  // size bytes
+  uint8_t *packet;
+  uint16_t size;
+  PacketDecodeResult result;
+};
+
+// Decode count frames, a decoder not supported by the CPU falls back to Scalar
+void decodeTmodeBatch(TmodeFrame *frames, size_t count, TmodeDecoder decoder = bestTmodeDecoder());
+// Drop-in replacement of decodeRXBytesTmode with the best decoder
+PacketDecodeResult decodeTmodeFast(const uint8_t *pByte, uint8_t *pPacket, uint16_t packetSize);
+
+// CRC field value of data (CRC-16/EN-13757), slicing-by-8
+uint16_t crcSlice8(const uint8_t *data, uint16_t length);
+
+#endif
@@ -0,0 +1,83 @@
+#include "capture_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool parseRecord(const uint8_t *data, size_t size, CaptureRecord &record, size_t &used) {
+  if (size < CAPTURE_HEADER_SIZE)
+    return false;
+  record.header = CaptureHeader::read(data);
+  if (size < static_cast<size_t>(CAPTURE_HEADER_SIZE + record.header.length))
+    return false;
+  record.raw.assign(data + CAPTURE_HEADER_SIZE, data + CAPTURE_HEADER_SIZE + record.header.length);
+  used = CAPTURE_HEADER_SIZE + record.header.length;
+  return true;
+}
+
+bool readTextLog(const std::string &content, std::vector<CaptureRecord> &records) {
+  // the prefix can be preceded by a timestamp from the serial monitor
+  const size_t prefixLength = strlen(CAPTURE_PREFIX);
+  size_t pos = 0;
+  while ((pos = content.find(CAPTURE_PREFIX, pos)) != std::string::npos) {
+    pos += prefixLength;
+    std::vector<uint8_t> bytes;
+    while (pos + 1 < content.size() && hexValue(content[pos]) >= 0 && hexValue(content[pos + 1]) >= 0) {
+      bytes.push_back(hexValue(content[pos]) << 4 | hexValue(content[pos + 1]));
+      pos += 2;
+    }
+    CaptureRecord record;
+    size_t used;
+    // truncated lines are ignored
+    if (parseRecord(bytes.data(), bytes.size(), record, used) && used == bytes.size())
+      records.push_back(std::move(record));
+  }
+  return true;
+}
+
+} // namespace
+
+bool readCaptureFile(const std::string &path, std::vector<CaptureRecord> &records) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  if (content.find(CAPTURE_PREFIX) != std::string::npos)
+    return readTextLog(content, records);
+
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(content.data());
+  size_t offset = 0;
+  while (offset < content.size()) {
+    CaptureRecord record;
+    size_t used;
+    if (!parseRecord(data + offset, content.size() - offset, record, used))
+      return false;
+    records.push_back(std::move(record));
+    offset += used;
+  }
+  return true;
+}
+
+bool writeCaptureFile(const std::string &path, const std::vector<CaptureRecord> &records) {
+  std::ofstream file(path, std::ios::binary);
+  for (const auto &record : records) {
+    uint8_t head[CAPTURE_HEADER_SIZE];
+    record.header.write(head);
+    file.write(reinterpret_cast<const char *>(head), sizeof(head));
+    file.write(reinterpret_cast<const char *>(record.raw.data()), record.raw.size());
+  }
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,20 @@
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "capture.h"
+
+struct CaptureRecord {
+  CaptureHeader header;
+  std::vector<uint8_t> raw;
+};
+
+// Read the records of a binary capture file, or of a serial log
+// containing CAPTURE_PREFIX lines. Records are appended to records.
+bool readCaptureFile(const std::string &path, std::vector<CaptureRecord> &records);
+bool writeCaptureFile(const std::string &path, const std::vector<CaptureRecord> &records);
+
+#endif
@@ -0,0 +1,137 @@
+#include "fake_wmbus_hal.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr uint8_t RegFifo = 0x00;
+constexpr uint8_t RegOpMode = 0x01;
+constexpr uint8_t RegFrfMsb = 0x06;
+constexpr uint8_t RegRssiValue = 0x11;
+constexpr uint8_t RegPayloadLength = 0x32;
+constexpr uint8_t RegFifoThresh = 0x35;
+constexpr uint8_t RegIrqFlags1 = 0x3E;
+constexpr uint8_t RegIrqFlags2 = 0x3F;
+
+constexpr uint8_t OPMODE_MASK = 0x07;
+constexpr uint8_t OPMODE_RX = 0x05;
+
+constexpr uint8_t IrqPllLock = 0x10;
+constexpr uint8_t IrqPreambleDetect = 0x02;
+constexpr uint8_t IrqSyncAddressMatch = 0x01;
+
+constexpr uint8_t IrqFifoEmpty = 0x40;
+constexpr uint8_t IrqFifoLevel = 0x20;
+constexpr uint8_t IrqPayloadReady = 0x04;
+
+constexpr size_t FIFO_SIZE = 64;
+} // namespace
+
+void FakeWmbusHal::receive(const uint8_t *raw, size_t size, uint8_t rssi, uint32_t frf) {
+  frames.push_back({std::vector<uint8_t>(raw, raw + size), rssi, frf});
+}
+
+void FakeWmbusHal::fill_fifo() {
+  if ((regs[RegOpMode] & OPMODE_MASK) != OPMODE_RX || frames.empty()) {
+    return;
+  }
+  Frame &frame = frames.front();
+  const uint32_t frf = regs[RegFrfMsb] << 16 | regs[RegFrfMsb + 1] << 8 | regs[RegFrfMsb + 2];
+  if (frame.frf != 0 && frame.frf != frf) {
+    return;
+  }
+  // fixed length packet, a short frame is completed with noise
+  frame.raw.resize(std::max<size_t>(regs[RegPayloadLength], 1), 0);
+  regs[RegRssiValue] = frame.rssi;
+  while (received < frame.raw.size() && fifo.size() < FIFO_SIZE) {
+    fifo.push_back(frame.raw[received++]);
+  }
+}
+
+bool FakeWmbusHal::payload_ready() const {
+  return !frames.empty() && received == frames.front().raw.size() && !fifo.empty();
+}
+
+uint8_t FakeWmbusHal::read_reg(uint8_t addr) {
+  uint8_t value;
+  read_buffer(addr, &value, 1);
+  return value;
+}
+
+void FakeWmbusHal::write_reg(uint8_t addr, uint8_t data) { write_buffer(addr, &data, 1); }
+
+void FakeWmbusHal::read_buffer(uint8_t addr, uint8_t *buf, uint8_t len) {
+  for (uint8_t i = 0; i < len; i++) {
+    if (addr == RegFifo) {
+      if (fifo.empty()) {
+        buf[i] = 0;
+        continue;
+      }
+      buf[i] = fifo.front();
+      fifo.pop_front();
+      if (fifo.empty() && !frames.empty() && received == frames.front().raw.size()) {
+        // end of the frame
+        frames.pop_front();
+        received = 0;
+      }
+      continue;
+    }
+    const uint8_t reg = (addr + i) & 0x7F;
+    if (reg == RegIrqFlags1) {
+      // the PLL locks at once, preamble and sync word are seen when the frame starts
+      buf[i] = IrqPllLock | (received > 0 ? IrqPreambleDetect | IrqSyncAddressMatch : 0);
+    } else if (reg == RegIrqFlags2) {
+      buf[i] = (fifo.empty() ? IrqFifoEmpty : 0) | (io_check1() ? IrqFifoLevel : 0) |
+               (payload_ready() ? IrqPayloadReady : 0);
+    } else {
+      buf[i] = regs[reg];
+    }
+  }
+}
+
+void FakeWmbusHal::write_buffer(uint8_t addr, const uint8_t *buf, uint8_t len) {
+  for (uint8_t i = 0; i < len; i++) {
+    if (addr != RegFifo) {
+      regs[(addr + i) & 0x7F] = buf[i];
+    }
+  }
+  if ((regs[RegOpMode] & OPMODE_MASK) != OPMODE_RX) {
+    // leaving RX, a partially received frame is lost
+    if (received > 0) {
+      frames.pop_front();
+      received = 0;
+    }
+    fifo.clear();
+  }
+}
+
+bool FakeWmbusHal::io_check0() {
+  fill_fifo();
+  return payload_ready();
+}
+
+bool FakeWmbusHal::io_check1() {
+  fill_fifo();
+  return fifo.size() > (regs[RegFifoThresh] & 0x3F);
+}
+
+bool FakeWmbusHal::wait_dio(OsDeltaTime timeout) {
+  // the lines only change when a frame is queued, nothing comes during the wait
+  if (io_check0() || io_check1()) {
+    return true;
+  }
+  advance(timeout);
+  return false;
+}
+
+void FakeWmbusHal::store(uint16_t address, const void *data, uint8_t size) {
+  if (address + size <= memory.size()) {
+    memcpy(memory.begin() + address, data, size);
+  }
+}
+
+void FakeWmbusHal::retrieve(uint16_t address, void *data, uint8_t size) {
+  if (address + size <= memory.size()) {
+    memcpy(data, memory.begin() + address, size);
+  }
+}
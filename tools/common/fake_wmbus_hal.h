@@ -0,0 +1,61 @@
+#ifndef FAKE_WMBUS_HAL_H
+#define FAKE_WMBUS_HAL_H
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+#include "wmbus_hal.h"
+
+// In-process SX1276 for host tools: registers are kept in memory and queued
+// frames are received, through the 64 bytes FIFO, when the radio is in RX.
+// The DIO lines follow the firmware mapping (DIO0 = PayloadReady,
+// DIO1 = FifoLevel), the next frame is received when they are checked.
+// A frame queued for a channel (RegFrf value) is only received on it.
+// The clock only moves with sleep(), advance() or a wait_dio() timeout.
+class FakeWmbusHal final : public WmbusHal {
+public:
+  // Queue a frame (bytes as read from the FIFO) with the RSSI read at its start,
+  // sent on the channel frf (0 for any channel)
+  void receive(const uint8_t *raw, size_t size, uint8_t rssi, uint32_t frf = 0);
+  size_t pending() const { return frames.size(); }
+  void advance(OsDeltaTime duration) { now = now + duration; }
+
+  uint8_t read_reg(uint8_t addr) override;
+  void write_reg(uint8_t addr, uint8_t data) override;
+  void read_buffer(uint8_t addr, uint8_t *buf, uint8_t len) override;
+  void write_buffer(uint8_t addr, const uint8_t *buf, uint8_t len) override;
+  bool io_check0() override;
+  bool io_check1() override;
+  bool wait_dio(OsDeltaTime timeout) override;
+
+  OsTime time() override { return now; }
+  void sleep(OsDeltaTime duration) override { advance(duration); }
+
+  uint16_t store_size() const override { return memory.size(); }
+  void store(uint16_t address, const void *data, uint8_t size) override;
+  void retrieve(uint16_t address, void *data, uint8_t size) override;
+
+private:
+  struct Frame {
+    std::vector<uint8_t> raw;
+    uint8_t rssi;
+    uint32_t frf;
+  };
+
+  // move the bytes of the current frame to the FIFO
+  void fill_fifo();
+  bool payload_ready() const;
+
+  std::array<uint8_t, 0x80> regs = {};
+  std::deque<Frame> frames;
+  std::deque<uint8_t> fifo;
+  // bytes of the current frame moved to the FIFO
+  size_t received = 0;
+  OsTime now{};
+  std::array<uint8_t, 1024> memory = {};
+};
+
+#endif
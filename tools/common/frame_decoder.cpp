@@ -0,0 +1,93 @@
+#include "frame_decoder.h"
+
+#include <algorithm>
+
+#include "3outof6.h"
+#include "izar.h"
+#include "mbus_packet.h"
+
+namespace {
+
+FrameStatus toFrameStatus(PacketDecodeResult result) {
+  switch (result) {
+  case PacketDecodeResult::OK:
+    return FrameStatus::OK;
+  case PacketDecodeResult::CODING_ERROR:
+    return FrameStatus::CODING_ERROR;
+  default:
+    return FrameStatus::CRC_ERROR;
+  }
+}
+
+template <typename Layout> FrameStatus extract(const uint8_t *packet, uint16_t size, FrameResult &result) {
+  // accept any meter, the id is checked by the caller
+  std::copy_n(packet + Layout::offset(4), result.id.size(), result.id.begin());
+  if (size != Layout::size)
+    return FrameStatus::NOT_IZAR;
+  if (!printAndExtractIZAR<Layout>(packet, size, result.id, result.reading))
+    return FrameStatus::NOT_IZAR;
+  return FrameStatus::OK;
+}
+
+} // namespace
+
+const char *frameStatusName(FrameStatus status) {
+  switch (status) {
+  case FrameStatus::OK:
+    return "ok";
+  case FrameStatus::CODING_ERROR:
+    return "coding error";
+  case FrameStatus::CRC_ERROR:
+    return "crc error";
+  case FrameStatus::LENGTH_ERROR:
+    return "length error";
+  default:
+    return "not izar";
+  }
+}
+
+FrameResult decodeCapture(const CaptureRecord &record) { return decodeRaw(record.header, record.raw.data()); }
+
+FrameStatus decodePacket(const CaptureHeader &header, const uint8_t *raw, uint8_t *packet, uint16_t &size,
+                         TmodeDecodeFunction decodeTmode) {
+  const uint16_t rawLength = header.length;
+
+  if (header.mode == WMBusMode::T1) {
+    // the L-field gives the size of the frame
+    if (rawLength < 2 || !decode3outof6(raw, packet, true))
+      return FrameStatus::CODING_ERROR;
+    size = packetSize(packet[0]);
+    if (rawLength < (size * 3 + 1) / 2)
+      return FrameStatus::LENGTH_ERROR;
+    return toFrameStatus(decodeTmode(raw, packet, size));
+  }
+
+  size = rawLength;
+  if (header.mode == WMBusMode::C1A) {
+    if (rawLength != IzarLayout::size)
+      return FrameStatus::LENGTH_ERROR;
+    std::copy_n(raw, size, packet);
+    return toFrameStatus(checkRXBytesCmode<IzarLayout>(raw));
+  }
+
+  if (rawLength != IzarLayoutB::size)
+    return FrameStatus::LENGTH_ERROR;
+  std::copy_n(raw, size, packet);
+  return toFrameStatus(checkRXBytesCmode<IzarLayoutB>(raw));
+}
+
+FrameResult decodeRaw(const CaptureHeader &header, const uint8_t *raw, TmodeDecodeFunction decodeTmode) {
+  FrameResult result = {};
+  // max frame size (L-field = 255)
+  uint8_t packet[300];
+  uint16_t size = 0;
+
+  result.status = decodePacket(header, raw, packet, size, decodeTmode);
+  if (result.status != FrameStatus::OK)
+    return result;
+  if (header.mode == WMBusMode::C1B)
+    result.status = extract<IzarLayoutB>(packet, size, result);
+  else
+    result.status = extract<IzarLayout>(packet, size, result);
+  return result;
+}
@@ -0,0 +1,43 @@
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <array>
+#include <stdint.h>
+
+#include "capture_file.h"
+#include "mbus_packet.h"
+
+enum class FrameStatus : uint8_t {
+  OK = 0,
+  CODING_ERROR,
+  CRC_ERROR,
+  // raw frame shorter than the length given by the L-field
+  LENGTH_ERROR,
+  // valid frame but not an IZAR frame
+  NOT_IZAR,
+};
+constexpr uint8_t NB_FRAME_STATUS = 5;
+
+const char *frameStatusName(FrameStatus status);
+
+struct FrameResult {
+  FrameStatus status;
+  // meter id (A field), valid if the frame decoding is OK
+  std::array<uint8_t, 6> id;
+  // see izar.h, valid if status is OK
+  std::array<uint8_t, 7> reading;
+};
+
+// Decode a captured frame with the firmware decoders
+FrameResult decodeCapture(const CaptureRecord &record);
+// Decoder of the T1 frames, decodeRXBytesTmode or a host decoder with the same results
+using TmodeDecodeFunction = PacketDecodeResult (*)(const uint8_t *pByte, uint8_t *pPacket, uint16_t packetSize);
+// Check the header.length raw bytes of a frame and copy the decoded frame to packet (up to 290 bytes),
+// the status is OK, CODING_ERROR, CRC_ERROR or LENGTH_ERROR. C1B frames must have the IzarLayoutB size.
+FrameStatus decodePacket(const CaptureHeader &header, const uint8_t *raw, uint8_t *packet, uint16_t &size,
+                         TmodeDecodeFunction decodeTmode = decodeRXBytesTmode);
+// Same with the header.length raw bytes of the frame
+FrameResult decodeRaw(const CaptureHeader &header, const uint8_t *raw,
+                      TmodeDecodeFunction decodeTmode = decodeRXBytesTmode);
+
+#endif
@@ -0,0 +1,50 @@
+#include "frame_encoder.h"
+
+namespace {
+// EN 13757-4 "3 out of 6" code of each nibble, the msb is transmitted first
+constexpr uint8_t symbols[16] = {0b010110, 0b001101, 0b001110, 0b001011, 0b011100, 0b011001, 0b011010, 0b010011,
+                                 0b101100, 0b100101, 0b100110, 0b100011, 0b110100, 0b110001, 0b110010, 0b101001};
+} // namespace
+
+void encode3outof6(const uint8_t *data, uint8_t *encodedData, bool lastByte) {
+  const uint8_t symbol0 = symbols[data[0] >> 4];
+  const uint8_t symbol1 = symbols[data[0] & 0x0F];
+  encodedData[0] = (symbol0 << 2) | (symbol1 >> 4);
+  if (lastByte) {
+    // postamble 0101
+    encodedData[1] = (symbol1 << 4) | 0x05;
+    return;
+  }
+  const uint8_t symbol2 = symbols[data[1] >> 4];
+  const uint8_t symbol3 = symbols[data[1] & 0x0F];
+  encodedData[1] = (symbol1 << 4) | (symbol2 >> 2);
+  encodedData[2] = (symbol2 << 6) | symbol3;
+}
+
+std::vector<uint8_t> encodeTmode(const uint8_t *packet, uint16_t size) {
+  std::vector<uint8_t> encoded((size * 3 + 1) / 2);
+  uint16_t i = 0;
+  for (; i + 1 < size; i += 2) {
+    encode3outof6(packet + i, encoded.data() + i / 2 * 3, false);
+  }
+  if (i < size) {
+    encode3outof6(packet + i, encoded.data() + i / 2 * 3, true);
+  }
+  return encoded;
+}
+
+void setCrcFields(uint8_t *packet, uint16_t size) {
+  for (uint16_t start = 0, end = std::min<uint16_t>(12, size); start < size;
+       start = end, end = std::min<uint16_t>(end + 18, size)) {
+    CrcCalc crc = {};
+    for (uint16_t i = start; i + 2 < end; i++) {
+      crc.pushData(packet[i]);
+    }
+    if (end - start == 1) {
+      packet[start] = crc.value() & 0xFF;
+    } else {
+      packet[end - 2] = crc.value() >> 8;
+      packet[end - 1] = crc.value() & 0xFF;
+    }
+  }
+}
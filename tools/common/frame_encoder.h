@@ -0,0 +1,71 @@
+#ifndef FRAME_ENCODER_H
+#define FRAME_ENCODER_H
+
+#include <algorithm>
+#include <array>
+#include <stdint.h>
+#include <vector>
+
+#include "crc.h"
+#include "izar.h"
+#include <lmic/bufferpack.h>
+
+// "3 out of 6" encoding of 2 bytes into 3 bytes, if lastByte only the
+// first byte into 2 bytes followed by the postamble (EN 13757-4 T mode).
+// Its table is written out here, not taken from the decoder, so that the
+// round trip tests check the decoder against the standard.
+void encode3outof6(const uint8_t *data, uint8_t *encodedData, bool lastByte);
+
+// "3 out of 6" encoding of a frame (T mode)
+std::vector<uint8_t> encodeTmode(const uint8_t *packet, uint16_t size);
+
+/// @brief Compute the CRC fields of a frame
+template <typename Layout> void setCrcFields(uint8_t *packet) {
+  for (uint8_t block = 0; block < Layout::nbBlocks; block++) {
+    uint8_t *data = packet + Layout::blockOffset(block);
+    CrcCalc crc = {};
+    for (uint8_t i = 0; i < Layout::blockDataLength(block); i++) {
+      crc.pushData(data[i]);
+    }
+    data += Layout::blockDataLength(block);
+    data[0] = crc.value() >> 8;
+    data[1] = crc.value() & 0xFF;
+  }
+}
+
+/// @brief Compute the CRC fields of a frame format A of any size, the last
+/// block can be a single byte (the low byte of a CRC field)
+void setCrcFields(uint8_t *packet, uint16_t size);
+
+/// @brief Build a valid IZAR frame with its CRC fields
+template <typename Layout>
+std::array<uint8_t, Layout::size> buildIzarFrame(const std::array<uint8_t, 6> &id, const std::array<uint8_t, 3> &flags,
+                                                 uint32_t index, uint32_t key = DIEHL_DEFAULT_KEY) {
+  std::array<uint8_t, Layout::size> packet = {};
+  packet[0] = Layout::lField;
+  packet[Layout::offset(1)] = 0x44;
+  packet[Layout::offset(2)] = 0x30;
+  packet[Layout::offset(3)] = 0x4C;
+  for (uint8_t i = 0; i < id.size(); i++) {
+    packet[Layout::offset(4 + i)] = id[i];
+  }
+  packet[Layout::ciOffset] = 0xA1;
+  for (uint8_t i = 0; i < flags.size(); i++) {
+    packet[Layout::ciOffset + 1 + i] = flags[i];
+  }
+  packet[Layout::ciOffset + 4] = 0x13;
+
+  // plain text: check byte, index, then unknown bytes left to 0
+  uint8_t *encrypted = packet.begin() + Layout::encryptedOffset;
+  encrypted[0] = 0x4B;
+  wlsbf4(encrypted + 1, index);
+  // the LFSR only xor the data, decoding the plain text encrypt it
+  uint8_t cipher[Layout::encryptedLength];
+  decodeDiehlLfsr<Layout>(packet.begin(), cipher, key);
+  std::copy_n(cipher, Layout::encryptedLength, encrypted);
+
+  setCrcFields<Layout>(packet.begin());
+  return packet;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "frame_text.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <lmic/bufferpack.h>
+
+const char *modeName(WMBusMode mode) {
+  switch (mode) {
+  case WMBusMode::T1:
+    return "T1";
+  case WMBusMode::C1A:
+    return "C1A";
+  default:
+    return "C1B";
+  }
+}
+
+std::string hex(const uint8_t *data, size_t size) {
+  std::string out;
+  char digits[3];
+  for (size_t i = 0; i < size; i++) {
+    snprintf(digits, sizeof(digits), "%02X", data[i]);
+    out += digits;
+  }
+  return out;
+}
+
+bool parseMeterId(const char *text, std::array<uint8_t, 6> &id) {
+  if (strlen(text) != 12)
+    return false;
+  for (size_t i = 0; i < id.size(); i++) {
+    char byte[3] = {text[2 * i], text[2 * i + 1], 0};
+    char *end;
+    id[i] = strtoul(byte, &end, 16);
+    if (*end != 0)
+      return false;
+  }
+  return true;
+}
+
+void printFrame(const CaptureHeader &header, const FrameResult &result) {
+  printf("%10u ms %6.1f dBm %-3s %-12s", header.time_ms, -header.rssi / 2.0,
+         modeName(header.mode), frameStatusName(result.status));
+  if (result.status == FrameStatus::OK || result.status == FrameStatus::NOT_IZAR)
+    printf(" ID: %s", hex(result.id.begin(), result.id.size()).c_str());
+  if (result.status == FrameStatus::OK) {
+    const uint32_t index = rlsbf4(result.reading.begin() + 3);
+    printf(" Status: %s Idx: %u.%03u", hex(result.reading.begin(), 3).c_str(), index / 1000, index % 1000);
+  }
+  printf("\n");
+}
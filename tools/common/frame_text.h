@@ -0,0 +1,17 @@
+#ifndef FRAME_TEXT_H
+#define FRAME_TEXT_H
+
+#include <array>
+#include <stdint.h>
+#include <string>
+
+#include "frame_decoder.h"
+
+const char *modeName(WMBusMode mode);
+std::string hex(const uint8_t *data, size_t size);
+// 12 hex digits, A field order
+bool parseMeterId(const char *text, std::array<uint8_t, 6> &id);
+// One line with time, RSSI, mode, status, meter id and reading
+void printFrame(const CaptureHeader &header, const FrameResult &result);
+
+#endif
@@ -0,0 +1,5 @@
+# libFuzzer and its sanitizers are only in clang, they are linked too
+Import("env")
+
+env.Replace(CC="clang", CXX="clang++", LINK="clang++")
+env.Append(LINKFLAGS=["-fsanitize=fuzzer,address,undefined"])
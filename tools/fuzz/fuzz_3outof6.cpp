@@ -0,0 +1,33 @@
+// libFuzzer target of decode3outof6: a valid coding must be the encoding of
+// the decoded bytes, for 2 bytes and for a last byte followed by the postamble.
+//
+// pio run -e fuzz_3outof6 && .pio/build/fuzz_3outof6/program -max_total_time=300
+
+#include <cstddef>
+#include <cstring>
+
+#include "3outof6.h"
+#include "frame_encoder.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (size < 3) {
+    return 0;
+  }
+  uint8_t decoded[2];
+  if (decode3outof6(data, decoded, false)) {
+    uint8_t encoded[3];
+    encode3outof6(decoded, encoded, false);
+    if (memcmp(encoded, data, sizeof(encoded)) != 0) {
+      __builtin_trap();
+    }
+  }
+  if (decode3outof6(data, decoded, true)) {
+    uint8_t encoded[2];
+    encode3outof6(decoded, encoded, true);
+    // the postamble is not checked
+    if (encoded[0] != data[0] || (encoded[1] & 0xF0) != (data[1] & 0xF0)) {
+      __builtin_trap();
+    }
+  }
+  return 0;
+}
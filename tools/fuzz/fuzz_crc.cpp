@@ -0,0 +1,74 @@
+// libFuzzer target of the block CRC checks:
+//  - a frame accepted by decodeRXBytesTmode must encode back to the input,
+//    on a frame of the IZAR layout its result must be the one of the layout
+//    decoder and an accepted frame must have the computed CRC fields,
+//  - checkRXBytesCmode must accept a frame only if its CRC fields are the
+//    computed ones (frame format A and B).
+//
+// pio run -e fuzz_crc && .pio/build/fuzz_crc/program -max_total_time=300
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "frame_encoder.h"
+#include "mbus_packet.h"
+
+namespace {
+// largest frame format A (L-field 255)
+constexpr uint16_t MAX_PACKET_SIZE = 290;
+
+void checkTmode(const uint8_t *data, size_t size) {
+  // encoded length of a packet: (packet * 3 + 1) / 2
+  const uint16_t packetSize = std::min<size_t>(size * 2 / 3, MAX_PACKET_SIZE);
+  if (packetSize < 2) {
+    return;
+  }
+  uint8_t packet[MAX_PACKET_SIZE];
+  const PacketDecodeResult result = decodeRXBytesTmode(data, packet, packetSize);
+  if (result == PacketDecodeResult::OK) {
+    const std::vector<uint8_t> encoded = encodeTmode(packet, packetSize);
+    // the postamble after an odd last byte is not checked
+    const size_t compared = packetSize % 2 ? encoded.size() - 1 : encoded.size();
+    if (memcmp(encoded.data(), data, compared) != 0 ||
+        (packetSize % 2 && (encoded.back() & 0xF0) != (data[compared] & 0xF0))) {
+      __builtin_trap();
+    }
+  }
+
+  if (packetSize == IzarLayout::size) {
+    uint8_t layoutPacket[IzarLayout::size];
+    if (decodeRXBytesTmode<IzarLayout>(data, layoutPacket) != result) {
+      __builtin_trap();
+    }
+    if (result == PacketDecodeResult::OK) {
+      uint8_t expected[IzarLayout::size];
+      std::copy_n(packet, IzarLayout::size, expected);
+      setCrcFields<IzarLayout>(expected);
+      if (memcmp(layoutPacket, packet, IzarLayout::size) != 0 || memcmp(expected, packet, IzarLayout::size) != 0) {
+        __builtin_trap();
+      }
+    }
+  }
+}
+
+template <typename Layout> void checkCmode(const uint8_t *data, size_t size) {
+  if (size < Layout::size) {
+    return;
+  }
+  uint8_t expected[Layout::size];
+  std::copy_n(data, Layout::size, expected);
+  setCrcFields<Layout>(expected);
+  const bool valid = memcmp(expected, data, Layout::size) == 0;
+  if ((checkRXBytesCmode<Layout>(data) == PacketDecodeResult::OK) != valid) {
+    __builtin_trap();
+  }
+}
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  checkTmode(data, size);
+  checkCmode<IzarLayout>(data, size);
+  checkCmode<IzarLayoutB>(data, size);
+  return 0;
+}
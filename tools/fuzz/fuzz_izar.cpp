@@ -0,0 +1,38 @@
+// libFuzzer target of printAndExtractIZAR (frame format A and B): a reading
+// extracted from a frame must be extracted again from the frame built with
+// its id, flags and index.
+//
+// pio run -e fuzz_izar && .pio/build/fuzz_izar/program -max_total_time=300
+
+#include <algorithm>
+#include <cstddef>
+
+#include "frame_encoder.h"
+#include "izar.h"
+#include <lmic/bufferpack.h>
+
+namespace {
+template <typename Layout> void checkIzar(const uint8_t *data, size_t size) {
+  if (size < Layout::size) {
+    return;
+  }
+  std::array<uint8_t, 6> id;
+  std::copy_n(data + Layout::offset(4), id.size(), id.begin());
+  std::array<uint8_t, 7> reading;
+  if (!printAndExtractIZAR<Layout>(data, std::min<size_t>(size, 0xFF), id, reading)) {
+    return;
+  }
+
+  const auto frame = buildIzarFrame<Layout>(id, {reading[0], reading[1], reading[2]}, rlsbf4(reading.begin() + 3));
+  std::array<uint8_t, 7> rebuilt;
+  if (!printAndExtractIZAR<Layout>(frame.begin(), frame.size(), id, rebuilt) || rebuilt != reading) {
+    __builtin_trap();
+  }
+}
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  checkIzar<IzarLayout>(data, size);
+  checkIzar<IzarLayoutB>(data, size);
+  return 0;
+}
@@ -0,0 +1,244 @@
+// Receive wireless MBUS frames with a SX1276 on a Linux board, using the
+// firmware receiver (RadioSx1276FSK) and decoders.
+//
+// usage: gateway [-c MODE | -C CHANNELS] [-m METER_ID] [-k KEY] [-s SPIDEV] [-g GPIOCHIP] [-0 LINE] [-1 LINE] [-o OUTPUT]
+//        gateway [-c MODE | -C CHANNELS] [-m METER_ID] [-k KEY] [-o OUTPUT] -f CAPTURE...
+//   -c MODE      T1 (default), C1A or C1B
+//   -C CHANNELS  listen in turn on several channels, FREQUENCY:MODE separated by commas
+//                (868950000:T1,869525000:C1A), the captures are sent on the channel of their mode
+//   -m METER_ID  meter whose readings are reported as Complete (12 hex digits, A field order)
+//   -k KEY       LFSR key of the meter (8 hex digits, see keysearch), default DIEHL_DEFAULT_KEY
+//   -s SPIDEV    default /dev/spidev0.0
+//   -g GPIOCHIP  default /dev/gpiochip0
+//   -0 LINE      DIO0 line offset, default 25
+//   -1 LINE      DIO1 line offset, default 24
+//   -o OUTPUT    write the received frames to a binary capture file (on exit for the radio)
+//   -f           use a fake radio fed with the frames of the captures, print the throughput
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "capture_file.h"
+#include "fake_wmbus_hal.h"
+#include "frame_decoder.h"
+#include "frame_text.h"
+#include "linux_wmbus_hal.h"
+#include "radio1276FSK.h"
+
+namespace {
+
+volatile sig_atomic_t stop = 0;
+
+void usage() {
+  fprintf(stderr,
+          "usage: gateway [-c MODE | -C CHANNELS] [-m METER_ID] [-k KEY] [-s SPIDEV] [-g GPIOCHIP] [-0 LINE] [-1 LINE]\n"
+          "               [-o OUTPUT]\n"
+          "       gateway [-c MODE | -C CHANNELS] [-m METER_ID] [-k KEY] [-o OUTPUT] -f CAPTURE...\n");
+}
+
+bool parseMode(const char *text, WMBusMode &mode) {
+  for (WMBusMode candidate : {WMBusMode::T1, WMBusMode::C1A, WMBusMode::C1B}) {
+    if (strcmp(text, modeName(candidate)) == 0) {
+      mode = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+// FREQUENCY:MODE,...
+bool parseChannels(const char *text, std::vector<WmbusChannel> &channels) {
+  std::string list = text;
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos)
+      end = list.size();
+    const std::string item = list.substr(start, end - start);
+    const size_t colon = item.find(':');
+    WMBusMode mode;
+    if (colon == std::string::npos || !parseMode(item.c_str() + colon + 1, mode))
+      return false;
+    channels.push_back(wmbusChannel(strtoul(item.c_str(), nullptr, 10), mode));
+    start = end + 1;
+  }
+  return !channels.empty() && channels.size() < 256;
+}
+
+// Longest wait for a DIO line between two polls: the channel dwell (40 ms)
+// and the end of a listen are checked by listen_wmbus()
+constexpr OsDeltaTime DIO_WAIT = OsDeltaTime::from_ms(5);
+
+// Fake radio: captures not received after this time are given up
+constexpr OsDeltaTime FAKE_IDLE_LIMIT = OsDeltaTime::from_sec(10);
+
+struct Counters {
+  uint32_t frames = 0;
+  uint32_t complete = 0;
+  uint32_t duplicate = 0;
+};
+
+// Listen once, decode and print a received frame
+void poll(RadioSx1276FSK &radio, WmbusHal &hal, OsTime origin, Counters &counters,
+          std::vector<CaptureRecord> *records) {
+  std::array<uint8_t, 7> reading;
+  const Listenstate state = radio.listen_wmbus(reading);
+  if (state == Listenstate::waiting) {
+    return;
+  }
+  counters.frames++;
+  counters.complete += state == Listenstate::Complete;
+  counters.duplicate += state == Listenstate::Duplicate;
+
+  CaptureRecord record;
+  record.header = {static_cast<uint32_t>((hal.time() - origin).to_ms()), radio.last_rssi(), radio.current_mode(),
+                   radio.rx_length()};
+  record.raw.assign(radio.last_raw(), radio.last_raw() + radio.rx_length());
+  printFrame(record.header, decodeCapture(record));
+  if (records != nullptr) {
+    records->push_back(std::move(record));
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  WMBusMode mode = WMBusMode::T1;
+  std::vector<WmbusChannel> channels;
+  std::array<uint8_t, 6> meterId = {};
+  uint32_t key = DIEHL_DEFAULT_KEY;
+  std::string spidev = "/dev/spidev0.0";
+  std::string gpiochip = "/dev/gpiochip0";
+  uint32_t dio0 = 25;
+  uint32_t dio1 = 24;
+  const char *output = nullptr;
+  bool fake = false;
+  std::vector<CaptureRecord> captures;
+
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "-c") == 0 && hasValue) {
+      if (!parseMode(argv[++i], mode)) {
+        usage();
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-C") == 0 && hasValue) {
+      if (!parseChannels(argv[++i], channels)) {
+        usage();
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-m") == 0 && hasValue) {
+      if (!parseMeterId(argv[++i], meterId)) {
+        usage();
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-k") == 0 && hasValue) {
+      key = strtoul(argv[++i], nullptr, 16);
+    } else if (strcmp(argv[i], "-s") == 0 && hasValue) {
+      spidev = argv[++i];
+    } else if (strcmp(argv[i], "-g") == 0 && hasValue) {
+      gpiochip = argv[++i];
+    } else if (strcmp(argv[i], "-0") == 0 && hasValue) {
+      dio0 = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "-1") == 0 && hasValue) {
+      dio1 = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "-o") == 0 && hasValue) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "-f") == 0) {
+      fake = true;
+    } else if (argv[i][0] == '-' || !fake) {
+      usage();
+      return 1;
+    } else if (!readCaptureFile(argv[i], captures)) {
+      fprintf(stderr, "Can not read capture %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  Counters counters;
+  std::vector<CaptureRecord> records;
+  std::vector<CaptureRecord> *recorded = output != nullptr ? &records : nullptr;
+
+  if (fake) {
+    FakeWmbusHal hal;
+    RadioSx1276FSK radio{hal, meterId, mode, key};
+    if (!channels.empty()) {
+      radio.set_channels(channels.data(), channels.size());
+    }
+    uint32_t skipped = 0;
+    for (const auto &capture : captures) {
+      if (channels.empty()) {
+        if (capture.header.mode == mode) {
+          // sent on the frequency of the meters, received only if the radio is tuned on it
+          hal.receive(capture.raw.data(), capture.raw.size(), capture.header.rssi,
+                      wmbusChannel(wmbusFrequency(mode), mode).frf);
+        } else {
+          skipped++;
+        }
+        continue;
+      }
+      const auto channel = std::find_if(channels.begin(), channels.end(), [&capture](const WmbusChannel &ch) {
+        return ch.mode == capture.header.mode;
+      });
+      if (channel != channels.end()) {
+        hal.receive(capture.raw.data(), capture.raw.size(), capture.header.rssi, channel->frf);
+      } else {
+        skipped++;
+      }
+    }
+    const OsTime origin = hal.time();
+    const auto start = std::chrono::steady_clock::now();
+    OsTime lastFrame = hal.time();
+    while (hal.pending() > 0) {
+      const uint32_t frames = counters.frames;
+      poll(radio, hal, origin, counters, recorded);
+      if (counters.frames != frames) {
+        lastFrame = hal.time();
+      } else if (hal.time() - lastFrame > FAKE_IDLE_LIMIT) {
+        // the radio never listens where the next capture is sent
+        break;
+      }
+      hal.wait_dio(DIO_WAIT);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%u frames received in %.3f ms", counters.frames, seconds * 1000);
+    if (seconds > 0)
+      printf(" (%.0f frames/s)", counters.frames / seconds);
+    printf(", %u captures of another mode skipped\n", skipped);
+    if (hal.pending() > 0) {
+      printf("%zu captures never received, the radio is not tuned on their channel\n", hal.pending());
+      return 1;
+    }
+  } else {
+    LinuxWmbusHal hal{spidev, gpiochip, dio0, dio1, "gateway.store"};
+    if (!hal.ok()) {
+      return 1;
+    }
+    RadioSx1276FSK radio{hal, meterId, mode, key};
+    if (!channels.empty()) {
+      radio.set_channels(channels.data(), channels.size());
+    }
+    signal(SIGINT, [](int) { stop = 1; });
+    const OsTime origin = hal.time();
+    while (!stop) {
+      poll(radio, hal, origin, counters, recorded);
+      hal.wait_dio(DIO_WAIT);
+    }
+    radio.stop_listen();
+    printf("%u frames received\n", counters.frames);
+  }
+  printf("  complete  %u\n  duplicate %u\n", counters.complete, counters.duplicate);
+
+  if (output != nullptr && !writeCaptureFile(output, records)) {
+    fprintf(stderr, "Can not write capture %s\n", output);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,259 @@
+// Search the LFSR key of IZAR meters which do not use the default key.
+//
+// usage: keysearch [-m METER_ID] [-i INDEX] [-t TOLERANCE] [-w THREADS] CAPTURE...
+//   -m METER_ID   search the key of this meter (12 hex digits, A field order),
+//                 needed if the captures contain PRIOS frames of several meters
+//   -i INDEX      index shown by the meter in liters
+//   -t TOLERANCE  the index of each frame must be within TOLERANCE liters of INDEX (default 1000)
+//   -w THREADS    number of search threads (default: number of cores)
+// Only use it on your own meters.
+//
+// The LFSR has no constant term: the key stream of key ^ header is the xor
+// of the key streams of the header and of the two 16-bit halves of the key.
+// For each high half, only the low halves giving the check byte 0x4B are
+// tried, taken from a table sorted by their first key stream byte. A key is
+// kept if in each frame the previous index (bytes 5-8) is not greater than
+// the index, the index is close to INDEX (or below 10^8 liters), and the
+// index never decreases from one frame to the next (captures in time order).
+// The xor of the plain texts of two frames does not depend on the key, more
+// frames barely reduce the number of keys found without INDEX.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "capture_file.h"
+#include "frame_decoder.h"
+#include "frame_text.h"
+#include "izar.h"
+#include <lmic/bufferpack.h>
+
+namespace {
+
+// without index hint
+constexpr uint32_t MAX_INDEX = 100000000;
+constexpr uint8_t CHECK_BYTE = 0x4B;
+constexpr size_t MAX_PRINTED_KEYS = 20;
+
+// Encrypted part decoded with a key: check byte and bytes 1-8 (index and previous index, little endian)
+struct Stream {
+  uint8_t check;
+  uint64_t data;
+};
+
+Stream toStream(const uint8_t *decoded) {
+  return {decoded[0], static_cast<uint64_t>(rlsbf4(decoded + 1)) | static_cast<uint64_t>(rlsbf4(decoded + 5)) << 32};
+}
+
+// Key stream of the 16-bit halves of the key
+struct HalfTables {
+  std::vector<Stream> low = std::vector<Stream>(0x10000);
+  std::vector<Stream> high = std::vector<Stream>(0x10000);
+  // low halves sorted by check byte, those with check byte c are at [bucket[c], bucket[c + 1])
+  std::vector<uint16_t> sortedLow = std::vector<uint16_t>(0x10000);
+  std::array<uint32_t, 257> bucket = {};
+};
+
+// Key stream of key, decoded from a frame with a zero header and zero encrypted part
+Stream keyStream(uint32_t key) {
+  const uint8_t zero[IzarLayout::size] = {};
+  uint8_t decoded[IzarLayout::encryptedLength];
+  decodeDiehlLfsr<IzarLayout>(zero, decoded, key);
+  return toStream(decoded);
+}
+
+void buildTables(HalfTables &tables) {
+  for (uint32_t half = 0; half < 0x10000; half++) {
+    tables.low[half] = keyStream(half);
+    tables.high[half] = keyStream(half << 16);
+    tables.bucket[tables.low[half].check + 1]++;
+  }
+  for (uint16_t check = 0; check < 256; check++) {
+    tables.bucket[check + 1] += tables.bucket[check];
+  }
+  std::array<uint32_t, 256> next;
+  std::copy_n(tables.bucket.begin(), next.size(), next.begin());
+  for (uint32_t half = 0; half < 0x10000; half++) {
+    tables.sortedLow[next[tables.low[half].check]++] = half;
+  }
+}
+
+template <typename Layout> bool isPrios(const uint8_t *packet, uint16_t size) {
+  return size == Layout::size && packet[0] == Layout::lField && packet[Layout::offset(1)] == 0x44 &&
+         packet[Layout::offset(2)] == 0x30 && packet[Layout::offset(3)] == 0x4C && packet[Layout::ciOffset] == 0xA1;
+}
+
+// Encrypted part decoded with a zero key (xored with the key stream of the header only)
+template <typename Layout> Stream headerStream(const uint8_t *packet) {
+  uint8_t decoded[Layout::encryptedLength];
+  decodeDiehlLfsr<Layout>(packet, decoded, 0);
+  return toStream(decoded);
+}
+
+struct Search {
+  const HalfTables &tables;
+  const std::vector<Stream> &frames;
+  bool hasHint;
+  uint32_t hint;
+  uint32_t tolerance;
+
+  bool plausible(uint64_t data, uint32_t &lastIndex) const {
+    const uint32_t index = data & 0xFFFFFFFF;
+    const uint32_t previous = data >> 32;
+    if (previous > index || index < lastIndex)
+      return false;
+    lastIndex = index;
+    if (hasHint)
+      return (index > hint ? index - hint : hint - index) <= tolerance;
+    return index < MAX_INDEX;
+  }
+
+  // Keys of the high halves [highBegin, highEnd)
+  void run(uint32_t highBegin, uint32_t highEnd, std::vector<uint32_t> &keys) const {
+    const uint8_t target = CHECK_BYTE ^ frames[0].check;
+    for (uint32_t high = highBegin; high < highEnd; high++) {
+      const Stream &highStream = tables.high[high];
+      const uint8_t check = target ^ highStream.check;
+      for (uint32_t i = tables.bucket[check]; i < tables.bucket[check + 1]; i++) {
+        const uint16_t low = tables.sortedLow[i];
+        const uint64_t stream = tables.low[low].data ^ highStream.data;
+        bool match = true;
+        uint32_t lastIndex = 0;
+        for (const auto &frame : frames) {
+          if (!plausible(frame.data ^ stream, lastIndex)) {
+            match = false;
+            break;
+          }
+        }
+        if (match)
+          keys.push_back(high << 16 | low);
+      }
+    }
+  }
+};
+
+void usage() { fprintf(stderr, "usage: keysearch [-m METER_ID] [-i INDEX] [-t TOLERANCE] [-w THREADS] CAPTURE...\n"); }
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool filterMeter = false;
+  std::array<uint8_t, 6> meterId = {};
+  bool hasHint = false;
+  uint32_t hint = 0;
+  uint32_t tolerance = 1000;
+  uint32_t nbThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<CaptureRecord> records;
+
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "-m") == 0 && hasValue) {
+      filterMeter = true;
+      if (!parseMeterId(argv[++i], meterId)) {
+        usage();
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-i") == 0 && hasValue) {
+      hasHint = true;
+      hint = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "-t") == 0 && hasValue) {
+      tolerance = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "-w") == 0 && hasValue) {
+      nbThreads = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (argv[i][0] == '-') {
+      usage();
+      return 1;
+    } else if (!readCaptureFile(argv[i], records)) {
+      fprintf(stderr, "Can not read capture %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  // PRIOS frames of each meter, whatever the key
+  std::map<std::array<uint8_t, 6>, std::vector<Stream>> meters;
+  for (const auto &record : records) {
+    uint8_t packet[300];
+    uint16_t size = 0;
+    if (decodePacket(record.header, record.raw.data(), packet, size) != FrameStatus::OK)
+      continue;
+    std::array<uint8_t, 6> id;
+    if (record.header.mode == WMBusMode::C1B) {
+      if (!isPrios<IzarLayoutB>(packet, size))
+        continue;
+      std::copy_n(packet + IzarLayoutB::offset(4), id.size(), id.begin());
+      meters[id].push_back(headerStream<IzarLayoutB>(packet));
+    } else {
+      if (!isPrios<IzarLayout>(packet, size))
+        continue;
+      std::copy_n(packet + IzarLayout::offset(4), id.size(), id.begin());
+      meters[id].push_back(headerStream<IzarLayout>(packet));
+    }
+  }
+  if (!filterMeter) {
+    if (meters.size() != 1) {
+      fprintf(stderr, "%zu meters with PRIOS frames, select one with -m\n", meters.size());
+      for (const auto &meter : meters) {
+        fprintf(stderr, "  %s %zu frames\n", hex(meter.first.begin(), meter.first.size()).c_str(),
+                meter.second.size());
+      }
+      return 1;
+    }
+    meterId = meters.begin()->first;
+  }
+  const std::vector<Stream> &frames = meters[meterId];
+  if (frames.empty()) {
+    fprintf(stderr, "No PRIOS frame of meter %s\n", hex(meterId.begin(), meterId.size()).c_str());
+    return 1;
+  }
+  // the check byte gives the same 8 bits of key stream in every frame
+  for (const auto &frame : frames) {
+    if (frame.check != frames[0].check) {
+      fprintf(stderr, "Check bytes of the frames do not match the same key\n");
+      return 1;
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  HalfTables tables;
+  buildTables(tables);
+  const Search search = {tables, frames, hasHint, hint, tolerance};
+  std::vector<std::vector<uint32_t>> found(nbThreads);
+  std::vector<std::thread> threads;
+  for (uint32_t thread = 0; thread < nbThreads; thread++) {
+    const uint32_t begin = 0x10000 * thread / nbThreads;
+    const uint32_t end = 0x10000 * (thread + 1) / nbThreads;
+    threads.emplace_back([&search, &found, thread, begin, end]() { search.run(begin, end, found[thread]); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::vector<uint32_t> keys;
+  for (const auto &threadKeys : found) {
+    keys.insert(keys.end(), threadKeys.begin(), threadKeys.end());
+  }
+  std::sort(keys.begin(), keys.end());
+
+  printf("%zu frames of meter %s, %u threads\n", frames.size(), hex(meterId.begin(), meterId.size()).c_str(),
+         nbThreads);
+  printf("2^32 keys in %.3f s (%.3g keys/s), 2^24 with the check byte decoded\n", seconds, 4294967296.0 / seconds);
+  printf("%zu keys found\n", keys.size());
+  for (size_t i = 0; i < std::min(keys.size(), MAX_PRINTED_KEYS); i++) {
+    const Stream stream = keyStream(keys[i]);
+    const uint64_t last = frames.back().data ^ stream.data;
+    const uint32_t index = last & 0xFFFFFFFF;
+    const uint32_t previous = last >> 32;
+    printf("  key %08X last idx %u.%03u previous %u.%03u%s\n", keys[i], index / 1000, index % 1000, previous / 1000,
+           previous % 1000, keys[i] == DIEHL_DEFAULT_KEY ? " (default key)" : "");
+  }
+  if (keys.size() > MAX_PRINTED_KEYS)
+    printf("  ... give the index shown by the meter with -i\n");
+  return keys.empty() ? 1 : 0;
+}
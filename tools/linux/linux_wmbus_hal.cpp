@@ -0,0 +1,167 @@
+#include "linux_wmbus_hal.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <linux/spi/spidev.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace {
+// SX1276 SPI: mode 0, up to 10 MHz
+constexpr uint32_t SPI_SPEED_HZ = 8000000;
+constexpr uint8_t SPI_WRITE = 0x80;
+
+int64_t monotonicUs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+int openOrPrint(const std::string &path, int flags) {
+  const int fd = open(path.c_str(), flags, 0644);
+  if (fd < 0) {
+    perror(path.c_str());
+  }
+  return fd;
+}
+} // namespace
+
+LinuxWmbusHal::LinuxWmbusHal(const std::string &spidev, const std::string &gpiochip, uint32_t dio0, uint32_t dio1,
+                             const std::string &storePath)
+    : originUs(monotonicUs()) {
+  spiFd = openOrPrint(spidev, O_RDWR);
+  if (spiFd >= 0) {
+    uint8_t mode = SPI_MODE_0;
+    uint8_t bits = 8;
+    uint32_t speed = SPI_SPEED_HZ;
+    if (ioctl(spiFd, SPI_IOC_WR_MODE, &mode) < 0 || ioctl(spiFd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+        ioctl(spiFd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+      perror("spi configuration");
+      close(spiFd);
+      spiFd = -1;
+    }
+  }
+
+  const int chipFd = openOrPrint(gpiochip, O_RDONLY);
+  if (chipFd >= 0) {
+    const uint32_t offsets[] = {dio0, dio1};
+    for (uint8_t line = 0; line < 2; line++) {
+      gpioevent_request request;
+      memset(&request, 0, sizeof(request));
+      request.lineoffset = offsets[line];
+      request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+      request.eventflags = GPIOEVENT_REQUEST_RISING_EDGE;
+      strncpy(request.consumer_label, "wmbus", sizeof(request.consumer_label) - 1);
+      if (ioctl(chipFd, GPIO_GET_LINEEVENT_IOCTL, &request) < 0) {
+        perror("gpio line events");
+        continue;
+      }
+      // events are drained without blocking
+      fcntl(request.fd, F_SETFL, fcntl(request.fd, F_GETFL) | O_NONBLOCK);
+      eventFds[line] = request.fd;
+    }
+    close(chipFd);
+  }
+
+  storeFd = openOrPrint(storePath, O_RDWR | O_CREAT);
+  if (storeFd >= 0 && ftruncate(storeFd, STORE_SIZE) < 0) {
+    perror(storePath.c_str());
+  }
+}
+
+LinuxWmbusHal::~LinuxWmbusHal() {
+  for (int fd : {spiFd, eventFds[0], eventFds[1], storeFd}) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+bool LinuxWmbusHal::transfer(uint8_t *buf, uint16_t len) {
+  spi_ioc_transfer transfer;
+  memset(&transfer, 0, sizeof(transfer));
+  transfer.tx_buf = reinterpret_cast<uintptr_t>(buf);
+  transfer.rx_buf = reinterpret_cast<uintptr_t>(buf);
+  transfer.len = len;
+  transfer.speed_hz = SPI_SPEED_HZ;
+  transfer.bits_per_word = 8;
+  return ioctl(spiFd, SPI_IOC_MESSAGE(1), &transfer) >= 0;
+}
+
+uint8_t LinuxWmbusHal::read_reg(uint8_t addr) {
+  uint8_t value = 0;
+  read_buffer(addr, &value, 1);
+  return value;
+}
+
+void LinuxWmbusHal::write_reg(uint8_t addr, uint8_t data) { write_buffer(addr, &data, 1); }
+
+void LinuxWmbusHal::read_buffer(uint8_t addr, uint8_t *buf, uint8_t len) {
+  // address byte then len bytes in the same transaction
+  uint8_t message[1 + 255] = {static_cast<uint8_t>(addr & ~SPI_WRITE)};
+  if (!transfer(message, 1 + len)) {
+    perror("spi read");
+    memset(buf, 0, len);
+    return;
+  }
+  memcpy(buf, message + 1, len);
+}
+
+void LinuxWmbusHal::write_buffer(uint8_t addr, const uint8_t *buf, uint8_t len) {
+  uint8_t message[1 + 255] = {static_cast<uint8_t>(addr | SPI_WRITE)};
+  memcpy(message + 1, buf, len);
+  if (!transfer(message, 1 + len)) {
+    perror("spi write");
+  }
+}
+
+bool LinuxWmbusHal::line_value(uint8_t line) {
+  gpiohandle_data data;
+  memset(&data, 0, sizeof(data));
+  if (ioctl(eventFds[line], GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0) {
+    return false;
+  }
+  return data.values[0] != 0;
+}
+
+bool LinuxWmbusHal::wait_dio(OsDeltaTime timeout) {
+  // an edge since the last wait is still queued, the levels are checked after the poll
+  if (line_value(0) || line_value(1)) {
+    return true;
+  }
+  pollfd fds[2] = {{eventFds[0], POLLIN, 0}, {eventFds[1], POLLIN, 0}};
+  const int64_t timeoutMs = timeout.to_ms();
+  if (::poll(fds, 2, timeoutMs > 0 ? static_cast<int>(timeoutMs) : 0) < 0) {
+    perror("gpio poll");
+  }
+  for (const pollfd &fd : fds) {
+    gpioevent_data event;
+    while ((fd.revents & POLLIN) && read(fd.fd, &event, sizeof(event)) == sizeof(event)) {
+    }
+  }
+  return line_value(0) || line_value(1);
+}
+
+OsTime LinuxWmbusHal::time() { return OsTime{} + OsDeltaTime::from_us(monotonicUs() - originUs); }
+
+void LinuxWmbusHal::sleep(OsDeltaTime duration) {
+  if (duration > OsDeltaTime::from_ms(0)) {
+    usleep(duration.to_ms() * 1000);
+  }
+}
+
+void LinuxWmbusHal::store(uint16_t address, const void *data, uint8_t size) {
+  if (pwrite(storeFd, data, size, address) != size) {
+    perror("store");
+  }
+}
+
+void LinuxWmbusHal::retrieve(uint16_t address, void *data, uint8_t size) {
+  if (pread(storeFd, data, size, address) != size) {
+    memset(data, 0xFF, size);
+  }
+}
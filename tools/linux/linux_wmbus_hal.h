@@ -0,0 +1,52 @@
+#ifndef LINUX_WMBUS_HAL_H
+#define LINUX_WMBUS_HAL_H
+
+#include <stdint.h>
+#include <string>
+
+#include "wmbus_hal.h"
+
+// SX1276 connected to a Linux board: SPI with spidev, DIO0 and DIO1 read
+// with the GPIO character device (rising edge events for wait_dio), monotonic
+// clock and a file as persistent store.
+class LinuxWmbusHal final : public WmbusHal {
+public:
+  // spidev: /dev/spidevB.C, gpiochip: /dev/gpiochipN, dio0/dio1: line offsets on the chip
+  LinuxWmbusHal(const std::string &spidev, const std::string &gpiochip, uint32_t dio0, uint32_t dio1,
+                const std::string &storePath);
+  ~LinuxWmbusHal();
+  LinuxWmbusHal(const LinuxWmbusHal &) = delete;
+  LinuxWmbusHal &operator=(const LinuxWmbusHal &) = delete;
+
+  // false if a device could not be opened (error printed on stderr)
+  bool ok() const { return spiFd >= 0 && eventFds[0] >= 0 && eventFds[1] >= 0 && storeFd >= 0; }
+
+  uint8_t read_reg(uint8_t addr) override;
+  void write_reg(uint8_t addr, uint8_t data) override;
+  void read_buffer(uint8_t addr, uint8_t *buf, uint8_t len) override;
+  void write_buffer(uint8_t addr, const uint8_t *buf, uint8_t len) override;
+  bool io_check0() override { return line_value(0); }
+  bool io_check1() override { return line_value(1); }
+  bool wait_dio(OsDeltaTime timeout) override;
+
+  OsTime time() override;
+  void sleep(OsDeltaTime duration) override;
+
+  uint16_t store_size() const override { return STORE_SIZE; }
+  void store(uint16_t address, const void *data, uint8_t size) override;
+  void retrieve(uint16_t address, void *data, uint8_t size) override;
+
+private:
+  static constexpr uint16_t STORE_SIZE = 1024;
+
+  bool transfer(uint8_t *buf, uint16_t len);
+  bool line_value(uint8_t line);
+
+  int spiFd = -1;
+  // one event request for each line, its values are read on the same fd
+  int eventFds[2] = {-1, -1};
+  int storeFd = -1;
+  int64_t originUs = 0;
+};
+
+#endif
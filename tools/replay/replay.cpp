@@ -0,0 +1,215 @@
+// Replay captured raw frames through the firmware decoders.
+//
+// usage: replay [-q] [-m METER_ID] [-g COUNT] [-o OUTPUT] CAPTURE...
+//   -q           only print statistics
+//   -m METER_ID  only print frames of this meter (12 hex digits, A field order)
+//   -g COUNT     add COUNT synthetic frames (some with injected errors), exit with 1 if one of them
+//                is not decoded as generated
+//   -o OUTPUT    write all records read to a binary capture file
+// CAPTURE is a binary capture file or a serial log with CAPTURE lines.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "capture_file.h"
+#include "frame_decoder.h"
+#include "frame_encoder.h"
+#include "frame_text.h"
+#include <lmic/bufferpack.h>
+
+namespace {
+
+struct MeterStats {
+  uint32_t frames = 0;
+  uint32_t izarFrames = 0;
+  uint32_t lastIndex = 0;
+  uint8_t minRssi = 0xFF;
+  uint8_t maxRssi = 0;
+};
+
+// What a synthetic frame must decode to, nothing is expected from a captured one
+struct Expected {
+  bool synthetic;
+  FrameStatus status;
+  std::array<uint8_t, 6> id;
+  uint32_t index;
+};
+
+bool matches(const Expected &expected, const FrameResult &result) {
+  if (!expected.synthetic) {
+    return true;
+  }
+  if (result.status != expected.status) {
+    return false;
+  }
+  // the id is valid once the frame is decoded, the index for an IZAR frame
+  if ((result.status == FrameStatus::OK || result.status == FrameStatus::NOT_IZAR) && result.id != expected.id) {
+    return false;
+  }
+  return result.status != FrameStatus::OK || rlsbf4(result.reading.begin() + 3) == expected.index;
+}
+
+void usage() { fprintf(stderr, "usage: replay [-q] [-m METER_ID] [-g COUNT] [-o OUTPUT] CAPTURE...\n"); }
+
+template <typename Layout>
+std::vector<uint8_t> syntheticFrame(std::mt19937 &random, const std::array<uint8_t, 6> &id, uint32_t index,
+                                    FrameStatus expected) {
+  auto packet = buildIzarFrame<Layout>(id, {0, 0, 0}, index);
+  if (expected == FrameStatus::NOT_IZAR) {
+    // EN 13757-3 short header instead of PRIOS
+    packet[Layout::ciOffset] = 0x7A;
+    setCrcFields<Layout>(packet.begin());
+  } else if (expected == FrameStatus::CRC_ERROR) {
+    // skip the L-field to keep the frame length
+    packet[1 + random() % (Layout::blockDataLength(0) - 1)] ^= 1 << (random() % 8);
+  }
+  return std::vector<uint8_t>(packet.begin(), packet.end());
+}
+
+// Frames of 8 meters in T1 and C1 mode, with 5% of each error.
+// expected is indexed as records.
+void generateRecords(uint32_t count, std::vector<CaptureRecord> &records, std::vector<Expected> &expected) {
+  expected.resize(records.size(), {false, FrameStatus::OK, {}, 0});
+  std::mt19937 random(count);
+  std::array<uint32_t, NB_FRAME_STATUS> expectedCount = {};
+  for (uint32_t i = 0; i < count; i++) {
+    const std::array<uint8_t, 6> id = {0x10, 0x20, 0x30, static_cast<uint8_t>(i % 8), 0x98, 0x01};
+    const uint32_t index = 100000 + i * 3;
+    const uint8_t draw = random() % 100;
+    const WMBusMode mode = draw < 80 ? WMBusMode::T1 : draw < 90 ? WMBusMode::C1A : WMBusMode::C1B;
+    const uint8_t error = random() % 20;
+    const FrameStatus status = error == 0   ? FrameStatus::CRC_ERROR
+                               : error == 1 ? FrameStatus::NOT_IZAR
+                               : error == 2 && mode == WMBusMode::T1 ? FrameStatus::CODING_ERROR
+                                                                     : FrameStatus::OK;
+
+    CaptureRecord record;
+    if (mode == WMBusMode::C1B) {
+      record.raw = syntheticFrame<IzarLayoutB>(random, id, index, status);
+    } else {
+      record.raw = syntheticFrame<IzarLayout>(random, id, index, status);
+    }
+    if (mode == WMBusMode::T1) {
+      record.raw = encodeTmode(record.raw.data(), record.raw.size());
+      if (status == FrameStatus::CODING_ERROR) {
+        // any single bit error give a symbol without 3 bits set, skip the L-field
+        record.raw[2 + random() % (record.raw.size() - 2)] ^= 1 << (random() % 8);
+      }
+    }
+    record.header = {i * 100, static_cast<uint8_t>(100 + random() % 60), mode, static_cast<uint8_t>(record.raw.size())};
+    records.push_back(std::move(record));
+    expected.push_back({true, status, id, index});
+    expectedCount[static_cast<uint8_t>(status)]++;
+  }
+
+  printf("%u synthetic frames\n", count);
+  for (uint8_t status = 0; status < NB_FRAME_STATUS; status++) {
+    printf("  %-12s %u\n", frameStatusName(static_cast<FrameStatus>(status)), expectedCount[status]);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool quiet = false;
+  bool filterMeter = false;
+  std::array<uint8_t, 6> wantedId = {};
+  const char *output = nullptr;
+  std::vector<CaptureRecord> records;
+  std::vector<Expected> expected;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0) {
+      quiet = true;
+    } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      filterMeter = true;
+      if (!parseMeterId(argv[++i], wantedId)) {
+        usage();
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+      generateRecords(strtoul(argv[++i], nullptr, 10), records, expected);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (argv[i][0] == '-') {
+      usage();
+      return 1;
+    } else if (!readCaptureFile(argv[i], records)) {
+      fprintf(stderr, "Can not read capture %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  std::array<uint32_t, NB_FRAME_STATUS> statusCount = {};
+  std::map<std::array<uint8_t, 6>, MeterStats> meters;
+  std::chrono::steady_clock::duration decodeTime{};
+  // records read after the synthetic ones have no expected result
+  expected.resize(records.size(), {false, FrameStatus::OK, {}, 0});
+  std::vector<size_t> mismatches;
+
+  for (size_t i = 0; i < records.size(); i++) {
+    const auto &record = records[i];
+    const auto start = std::chrono::steady_clock::now();
+    const FrameResult result = decodeCapture(record);
+    decodeTime += std::chrono::steady_clock::now() - start;
+    if (!matches(expected[i], result)) {
+      mismatches.push_back(i);
+    }
+
+    statusCount[static_cast<uint8_t>(result.status)]++;
+    const bool decoded = result.status == FrameStatus::OK || result.status == FrameStatus::NOT_IZAR;
+    if (decoded) {
+      auto &meter = meters[result.id];
+      meter.frames++;
+      meter.minRssi = std::min(meter.minRssi, record.header.rssi);
+      meter.maxRssi = std::max(meter.maxRssi, record.header.rssi);
+      if (result.status == FrameStatus::OK) {
+        meter.izarFrames++;
+        meter.lastIndex = rlsbf4(result.reading.begin() + 3);
+      }
+    }
+
+    if (quiet || (filterMeter && (!decoded || result.id != wantedId)))
+      continue;
+    printFrame(record.header, result);
+  }
+
+  const double seconds = std::chrono::duration<double>(decodeTime).count();
+  printf("%zu frames decoded in %.3f ms", records.size(), seconds * 1000);
+  if (seconds > 0)
+    printf(" (%.0f frames/s)", records.size() / seconds);
+  printf("\n");
+  for (uint8_t status = 0; status < NB_FRAME_STATUS; status++) {
+    printf("  %-12s %u\n", frameStatusName(static_cast<FrameStatus>(status)), statusCount[status]);
+  }
+  printf("%zu meters\n", meters.size());
+  for (const auto &meter : meters) {
+    printf("  %s frames %u izar %u", hex(meter.first.begin(), meter.first.size()).c_str(), meter.second.frames,
+           meter.second.izarFrames);
+    if (meter.second.izarFrames > 0)
+      printf(" last idx %u.%03u", meter.second.lastIndex / 1000, meter.second.lastIndex % 1000);
+    printf(" rssi %.1f/%.1f dBm\n", -meter.second.maxRssi / 2.0, -meter.second.minRssi / 2.0);
+  }
+
+  if (output != nullptr && !writeCaptureFile(output, records)) {
+    fprintf(stderr, "Can not write capture %s\n", output);
+    return 1;
+  }
+  if (!mismatches.empty()) {
+    printf("%zu synthetic frames not decoded as generated\n", mismatches.size());
+    for (size_t i = 0; i < mismatches.size() && i < 10; i++) {
+      const size_t record = mismatches[i];
+      printf("  frame %zu: %s, expected %s\n", record, frameStatusName(decodeCapture(records[record]).status),
+             frameStatusName(expected[record].status));
+    }
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,239 @@
+// Check the batch T mode decoders against decodeRXBytesTmode and measure their throughput.
+//
+// usage: tbatch [-g COUNT] [-r REPEAT] [CAPTURE...]
+//   -g COUNT   add COUNT random frames of any length, with injected errors (default 10000)
+//   -r REPEAT  decode the frames REPEAT times for the throughput (default 100)
+// The T1 frames of each CAPTURE are added to the random ones. The result and
+// the packet of each decoder must be the same as decodeRXBytesTmode, the
+// exit code is 1 on any difference.
+// The time per IZAR frame of decodeRXBytesTmode with the size given at run
+// time and of its IzarLayout instantiation is printed last (COUNT frames).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "batch_decoder.h"
+#include "capture_file.h"
+#include "frame_encoder.h"
+#include "frame_text.h"
+
+namespace {
+
+struct Frame {
+  std::vector<uint8_t> encoded;
+  uint16_t size;
+};
+
+void usage() { fprintf(stderr, "usage: tbatch [-g COUNT] [-r REPEAT] [CAPTURE...]\n"); }
+
+// Half of the frames with the size given by their L-field, half of any size up to 300 bytes.
+// 1/4 valid, 1/4 with a data bit error, 1/4 with an encoded bit error, 1/4 with 2 encoded bit errors
+void generateFrames(uint32_t count, std::vector<Frame> &frames) {
+  std::mt19937 random(count);
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t lField = random();
+    const uint16_t size = i % 2 ? packetSize(lField) : 1 + random() % 300;
+    std::vector<uint8_t> packet(size);
+    for (auto &byte : packet) {
+      byte = random();
+    }
+    packet[0] = lField;
+    setCrcFields(packet.data(), size);
+    const uint8_t error = random() % 4;
+    if (error == 1)
+      packet[random() % size] ^= 1 << (random() % 8);
+    Frame frame = {encodeTmode(packet.data(), size), size};
+    for (uint8_t n = 1; n < error; n++) {
+      frame.encoded[random() % frame.encoded.size()] ^= 1 << (random() % 8);
+    }
+    frames.push_back(std::move(frame));
+  }
+}
+
+void addCaptureFrames(const std::vector<CaptureRecord> &records, std::vector<Frame> &frames) {
+  for (const auto &record : records) {
+    uint8_t lField[2];
+    if (record.header.mode != WMBusMode::T1 || record.raw.size() < 2 ||
+        !decode3outof6(record.raw.data(), lField, true))
+      continue;
+    const uint16_t size = packetSize(lField[0]);
+    if (record.raw.size() < static_cast<size_t>((size * 3 + 1) / 2))
+      continue;
+    frames.push_back({record.raw, size});
+  }
+}
+
+const char *resultName(PacketDecodeResult result) {
+  switch (result) {
+  case PacketDecodeResult::OK:
+    return "ok";
+  case PacketDecodeResult::CODING_ERROR:
+    return "coding error";
+  default:
+    return "crc error";
+  }
+}
+
+// Number of frames decoded differently than by decodeRXBytesTmode
+uint32_t verify(const std::vector<Frame> &frames, TmodeDecoder decoder) {
+  uint32_t differences = 0;
+  uint8_t expected[300];
+  uint8_t packet[300];
+  for (const auto &frame : frames) {
+    const PacketDecodeResult reference = decodeRXBytesTmode(frame.encoded.data(), expected, frame.size);
+    TmodeFrame batch = {frame.encoded.data(), packet, frame.size, PacketDecodeResult::OK};
+    decodeTmodeBatch(&batch, 1, decoder);
+    if (batch.result == reference &&
+        (reference != PacketDecodeResult::OK || std::equal(expected, expected + frame.size, packet)))
+      continue;
+    if (differences++ < 10) {
+      printf("  size %u expected %s got %s: %s\n", frame.size, resultName(reference), resultName(batch.result),
+             hex(frame.encoded.data(), frame.encoded.size()).c_str());
+    }
+  }
+  return differences;
+}
+
+uint32_t verifyCrc(uint32_t count) {
+  std::mt19937 random(count);
+  uint32_t differences = 0;
+  uint8_t data[300];
+  for (uint32_t i = 0; i < count; i++) {
+    const uint16_t length = random() % sizeof(data);
+    CrcCalc crc = {};
+    for (uint16_t j = 0; j < length; j++) {
+      data[j] = random();
+      crc.pushData(data[j]);
+    }
+    differences += crcSlice8(data, length) != crc.value();
+  }
+  return differences;
+}
+
+template <typename Decode> double framesPerSecond(const std::vector<Frame> &frames, uint32_t repeat, Decode decode) {
+  std::vector<uint8_t> packets(frames.size() * 300);
+  std::vector<TmodeFrame> batch;
+  for (size_t i = 0; i < frames.size(); i++) {
+    batch.push_back({frames[i].encoded.data(), packets.data() + i * 300, frames[i].size, PacketDecodeResult::OK});
+  }
+  uint32_t ok = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t round = 0; round < repeat; round++) {
+    decode(batch);
+    ok += batch[round % batch.size()].result == PacketDecodeResult::OK;
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  // keep the results alive
+  if (ok > repeat)
+    printf("\n");
+  return static_cast<double>(frames.size()) * repeat / seconds;
+}
+
+// Nanoseconds per frame of decode on valid IZAR frames
+template <typename Decode>
+double nsPerIzarFrame(const std::vector<std::vector<uint8_t>> &frames, uint32_t repeat, Decode decode) {
+  uint8_t packet[IzarLayout::size];
+  uint32_t ok = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t round = 0; round < repeat; round++) {
+    for (const auto &frame : frames) {
+      ok += decode(frame.data(), packet) == PacketDecodeResult::OK;
+    }
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (ok != frames.size() * repeat)
+    printf("  %u frames not decoded\n", static_cast<unsigned>(frames.size() * repeat - ok));
+  return seconds * 1e9 / (static_cast<double>(frames.size()) * repeat);
+}
+
+// Frame layout template against the run time size, both must give the same packet
+uint32_t benchmarkLayout(uint32_t count, uint32_t repeat) {
+  std::mt19937 random(count);
+  std::vector<std::vector<uint8_t>> frames;
+  for (uint32_t i = 0; i < std::max<uint32_t>(count, 1); i++) {
+    const auto packet = buildIzarFrame<IzarLayout>({0x10, 0x20, 0x30, 0x07, 0x98, 0x01}, {0, 0, 0}, random());
+    frames.push_back(encodeTmode(packet.begin(), packet.size()));
+  }
+
+  uint32_t differences = 0;
+  for (const auto &frame : frames) {
+    uint8_t runtime[IzarLayout::size];
+    uint8_t layout[IzarLayout::size];
+    const PacketDecodeResult reference = decodeRXBytesTmode(frame.data(), runtime, IzarLayout::size);
+    differences += decodeRXBytesTmode<IzarLayout>(frame.data(), layout) != reference ||
+                   !std::equal(runtime, runtime + IzarLayout::size, layout);
+  }
+
+  const double runtime = nsPerIzarFrame(frames, repeat, [](const uint8_t *encoded, uint8_t *packet) {
+    return decodeRXBytesTmode(encoded, packet, IzarLayout::size);
+  });
+  const double layout = nsPerIzarFrame(frames, repeat, [](const uint8_t *encoded, uint8_t *packet) {
+    return decodeRXBytesTmode<IzarLayout>(encoded, packet);
+  });
+  printf("IZAR frames, %u differences\n", differences);
+  printf("  %-8s %.1f ns/frame\n", "runtime", runtime);
+  printf("  %-8s %.1f ns/frame\n", "layout", layout);
+  return differences;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t count = 10000;
+  uint32_t repeat = 100;
+  std::vector<CaptureRecord> records;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+      count = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      repeat = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (argv[i][0] == '-') {
+      usage();
+      return 1;
+    } else if (!readCaptureFile(argv[i], records)) {
+      fprintf(stderr, "Can not read capture %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  std::vector<Frame> frames;
+  generateFrames(count, frames);
+  addCaptureFrames(records, frames);
+  if (frames.empty()) {
+    usage();
+    return 1;
+  }
+
+  std::vector<TmodeDecoder> decoders = {TmodeDecoder::Scalar};
+  if (bestTmodeDecoder() != TmodeDecoder::Scalar)
+    decoders.push_back(bestTmodeDecoder());
+
+  uint32_t differences = verifyCrc(count);
+  printf("%zu frames, crc %s\n", frames.size(), differences == 0 ? "ok" : "differs");
+  for (const TmodeDecoder decoder : decoders) {
+    const uint32_t decoderDifferences = verify(frames, decoder);
+    printf("  %-8s %u differences\n", tmodeDecoderName(decoder), decoderDifferences);
+    differences += decoderDifferences;
+  }
+
+  printf("throughput on one core\n");
+  const double reference = framesPerSecond(frames, repeat, [](std::vector<TmodeFrame> &batch) {
+    for (auto &frame : batch) {
+      frame.result = decodeRXBytesTmode(frame.encoded, frame.packet, frame.size);
+    }
+  });
+  printf("  %-8s %.0f frames/s\n", "firmware", reference);
+  for (const TmodeDecoder decoder : decoders) {
+    const double rate = framesPerSecond(frames, repeat, [decoder](std::vector<TmodeFrame> &batch) {
+      decodeTmodeBatch(batch.data(), batch.size(), decoder);
+    });
+    printf("  %-8s %.0f frames/s (x%.2f)\n", tmodeDecoderName(decoder), rate, rate / reference);
+  }
+  differences += benchmarkLayout(count, repeat);
+  return differences == 0 ? 0 : 1;
+}